@@ -67,6 +67,9 @@ extern "C" {
         PyObject *m = PyModule_Create(&_jccmodule);
         if (!m)
             return NULL;
+#ifdef Py_GIL_DISABLED
+        PyUnstable_Module_SetGIL(m, Py_MOD_GIL_NOT_USED);
+#endif
 #else
     void init_jcc(void)
     {
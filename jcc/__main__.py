@@ -50,6 +50,20 @@ if len(sys.argv) == 1 or '--help' in sys.argv:
                               CLASS
     --mapping CLASS METHODSIGNATURE1 METHODSIGNATURE2
                             - generate a pythonic map protocol wrapper for CLASS
+    --async CLASS METHOD1,METHOD2,...
+                            - make calls from Java to the named void methods
+                              of extension CLASS taking primitive arguments
+                              return at once, queueing them for a drainer
+                              thread started with env.startCallQueue()
+    --cache-strings CLASS METHOD1,METHOD2,...
+                            - convert the String results of the named methods
+                              of CLASS through a cache keyed by Java object
+                              identity, see env.setStringCache()
+    --lazy-strings CLASS METHOD1,METHOD2,...
+                            - return the String results of the named methods
+                              of CLASS as jcc.JavaStr proxies, only decoded
+                              when used as a str and passed back to Java
+                              without any conversion
     --rename CLASS1=NAME1,CLASS2=NAME2,...
                             - rename one or more Python wrapper classes to
                               avoid name clashes due to the flattening of
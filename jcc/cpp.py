@@ -369,6 +369,9 @@ def jcc(args):
     version = ''
     mappings = {}
     sequences = {}
+    asyncs = {}
+    cachedStrings = {}
+    lazyStrings = {}
     renames = {}
     use_full_names = False
     env = None
@@ -457,6 +460,15 @@ def jcc(args):
             elif arg == '--sequence':
                 sequences[args[i + 1]] = (args[i + 2], args[i + 3])
                 i += 3
+            elif arg == '--async':
+                asyncs.setdefault(args[i + 1], set()).update(args[i + 2].split(','))
+                i += 2
+            elif arg == '--cache-strings':
+                cachedStrings.setdefault(args[i + 1], set()).update(args[i + 2].split(','))
+                i += 2
+            elif arg == '--lazy-strings':
+                lazyStrings.setdefault(args[i + 1], set()).update(args[i + 2].split(','))
+                i += 2
             elif arg == '--rename':
                 i += 1
                 renames.update(dict([arg.split('=')
@@ -670,7 +682,9 @@ def jcc(args):
                            constructors, methods, protectedMethods,
                            methodNames, fields, instanceFields,
                            mappings.get(className), sequences.get(className),
-                           renames.get(className),
+                           renames.get(className), asyncs.get(className),
+                           cachedStrings.get(className),
+                           lazyStrings.get(className),
                            declares, typeset, moduleName, generics,
                            _dll_export)
 
@@ -36,7 +36,7 @@ PyInt_FromLong = "PyInt_FromLong" if (sys.version_info[0] < 3) else "PyLong_From
 
 RESULTS = { 'boolean': 'Py_RETURN_BOOL(%s);',
             'byte': 'return '+PyInt_FromLong+'((long) %s);',
-            'char': 'return PyUnicode_FromUnicode((Py_UNICODE *) &%s, 1);',
+            'char': 'return PyUnicode_FromOrdinal((int) %s);',
             'double': 'return PyFloat_FromDouble((double) %s);',
             'float': 'return PyFloat_FromDouble((double) %s);',
             'int': 'return '+PyInt_FromLong+'((long) %s);',
@@ -46,7 +46,7 @@ RESULTS = { 'boolean': 'Py_RETURN_BOOL(%s);',
 
 CALLARGS = { 'boolean': ('O', '(%s ? Py_True : Py_False)', False),
              'byte': ('O', PyInt_FromLong+'(%s)', True),
-             'char': ('O', 'PyUnicode_FromUnicode((Py_UNICODE *) &%s, 1)', True),
+             'char': ('O', 'PyUnicode_FromOrdinal((int) %s)', True),
              'double': ('d', '(double) %s', False),
              'float': ('f', '(float) %s', False),
              'int': ('i', '(int) %s', False),
@@ -319,7 +319,7 @@ def returnValue(cls, returnType, value, genericRT=None, typeParams=None):
 
 
 def call(out, indent, cls, inCase, method, names, cardinality, isExtension,
-         generics):
+         generics, cacheStrings=False, lazyStrings=False):
 
     if inCase:
         line(out, indent, '{')
@@ -384,6 +384,10 @@ def call(out, indent, cls, inCase, method, names, cardinality, isExtension,
         line(out, indent + 1, 'return arg;')
         line(out, indent, '}')
         line(out, indent, 'return PyErr_SetArgsError("%s", arg);' %(name))
+    elif returnName == 'java.lang.String' and lazyStrings:
+        line(out, indent, 'return env->wrapJavaStr((jstring) result.this$);')
+    elif returnName == 'java.lang.String' and cacheStrings:
+        line(out, indent, 'return env->fromJStringCached((jstring) result.this$);')
     elif returnName != 'void':
         line(out, indent, returnValue(cls, returnType, 'result',
                                       genericRT, typeParams))
@@ -449,7 +453,27 @@ def wrapper_typename(returnType, cls):
     return "%s%st_%s" %(ns, sep, n)
 
 
-def extension(env, out, indent, cls, names, name, count, method, generics):
+def extension(env, out, indent, cls, names, name, count, method, generics,
+              isAsync=False):
+
+    if isAsync:
+        params = method.getParameterTypes()
+        if method.getReturnType().getName() != 'void' or \
+           len(params) > 8 or \
+           [param for param in params if not param.isPrimitive()]:
+            raise ValueError(cls, name, '--async methods must return void and take at most 8 primitive arguments')
+
+        types = ''.join([PRIMITIVES[param.getName()] for param in params])
+        if params:
+            line(out, indent, 'jvalue args[%d];', len(params))
+            for i in range(len(params)):
+                line(out, indent, 'args[%d].%s = a%d;', i, types[i].lower(), i)
+        line(out)
+        line(out, indent, 'if (env->queueCall(jenv, jobj, %s::mids$[%s::mid_pythonExtension_%s], "%s", "%s", %s))',
+             cppname(names[-1]), cppname(names[-1]), env.strhash('()J'),
+             name, types, params and 'args' or 'NULL')
+        line(out, indent + 1, 'return;')
+        line(out)
 
     line(out, indent, 'jlong ptr = jenv->CallLongMethod(jobj, %s::mids$[%s::mid_pythonExtension_%s]);',
          cppname(names[-1]), cppname(names[-1]), env.strhash('()J'))
@@ -551,7 +575,8 @@ def extension(env, out, indent, cls, names, name, count, method, generics):
 def python(env, out_h, out, cls, superCls, names, superNames,
            constructors, methods, protectedMethods,
            methodNames, fields, instanceFields,
-           mapping, sequence, rename, declares, typeset, moduleName, generics,
+           mapping, sequence, rename, asyncs, cachedStrings, lazyStrings,
+           declares, typeset, moduleName, generics,
            _dll_export):
 
     line(out_h)
@@ -598,8 +623,9 @@ def python(env, out_h, out, cls, superCls, names, superNames,
     if env.java_version >= '1.5':
         iterable = findClass('java/lang/Iterable')
         iterator = findClass('java/util/Iterator')
+        future = findClass('java/util/concurrent/Future')
     else:
-        iterable = iterator = None
+        iterable = iterator = future = None
 
     enumeration = findClass('java/util/Enumeration')
 
@@ -1045,6 +1071,11 @@ def python(env, out_h, out, cls, superCls, names, superNames,
     line(out)
     line(out, indent, 'void t_%s::install(PyObject *module)', names[-1])
     line(out, indent, '{')
+    if future is not None and future.isAssignableFrom(cls):
+        line(out, 0, '#if PY_VERSION_HEX >= 0x03050000')
+        line(out, indent + 1, 'PY_TYPE(%s).tp_as_async = &future_as_async;',
+             names[-1])
+        line(out, 0, '#endif')
     line(out, indent + 1, 'installType(&PY_TYPE(%s), module, "%s", %d);',
          names[-1], rename or names[-1], isExtension and 1 or 0)
     for inner in cls.getDeclaredClasses():
@@ -1177,6 +1208,8 @@ def python(env, out_h, out, cls, superCls, names, superNames,
     for name, methods in allMethods:
         line(out)
         modifiers = methods[0].getModifiers()
+        cacheStrings = cachedStrings is not None and name in cachedStrings
+        lazy = lazyStrings is not None and name in lazyStrings
 
         if isExtension and name == 'clone' and Modifier.isNative(modifiers):
             declargs, args, cardinality = ', PyObject *arg', ', arg', 1
@@ -1203,11 +1236,11 @@ def python(env, out_h, out, cls, superCls, names, superNames,
                     currLen = len(params)
                     line(out, indent + 1, '%scase %d:', HALF_INDENT, currLen)
                 call(out, indent + 2, cls, True, method, names, cardinality,
-                     isExtension, generics)
+                     isExtension, generics, cacheStrings, lazy)
             line(out, indent + 1, '}')
         else:
             call(out, indent + 1, cls, False, methods[0], names, cardinality,
-                 isExtension, generics)
+                 isExtension, generics, cacheStrings, lazy)
 
         if args:
             line(out)
@@ -1237,7 +1270,7 @@ def python(env, out_h, out, cls, superCls, names, superNames,
                 count += 1
                 line(out, indent, '{')
                 extension(env, out, indent + 1, cls, names, name, count, method,
-                          generics)
+                          generics, asyncs and name in asyncs)
                 line(out, indent, '}')
         line(out)
         line(out, indent, 'static PyObject *t_%s_get__self(t_%s *self, void *data)',
@@ -1554,7 +1587,7 @@ def module(out, allInOne, classes, imports, cppdir, moduleName,
     line(out)
     line(out, 0, 'PyObject *initJCC(PyObject *module);')
     line(out, 0, 'void __install__(PyObject *module);')
-    line(out, 0, 'extern PyTypeObject PY_TYPE(JObject), PY_TYPE(ConstVariableDescriptor), PY_TYPE(FinalizerClass), PY_TYPE(FinalizerProxy);')
+    line(out, 0, 'extern PyTypeObject PY_TYPE(JObject), PY_TYPE(ConstVariableDescriptor), PY_TYPE(FinalizerClass), PY_TYPE(FinalizerProxy), PY_TYPE(StringIterator);')
     line(out, 0, 'extern void _install_jarray(PyObject *);')
     line(out)
     line(out, 0, 'extern "C" {')
@@ -1571,6 +1604,9 @@ def module(out, allInOne, classes, imports, cppdir, moduleName,
         line(out, 1, 'PyObject *PyInit_%s(void)', extname)
         line(out, 1, '{')
         line(out, 2, 'PyObject *module = PyModule_Create(&%s_def);', extname);
+        line(out, 0, '#ifdef Py_GIL_DISABLED')
+        line(out, 2, 'PyUnstable_Module_SetGIL(module, Py_MOD_GIL_NOT_USED);')
+        line(out, 0, '#endif')
     else:
         line(out)
         line(out, 1, 'void init%s(void)', extname)
@@ -1585,6 +1621,7 @@ def module(out, allInOne, classes, imports, cppdir, moduleName,
     line(out, 2, 'INSTALL_TYPE(ConstVariableDescriptor, module);')
     line(out, 2, 'INSTALL_TYPE(FinalizerClass, module);')
     line(out, 2, 'INSTALL_TYPE(FinalizerProxy, module);')
+    line(out, 2, 'INSTALL_TYPE(StringIterator, module);')
     line(out, 2, '_install_jarray(module);')
     line(out, 2, '__install__(module);')
     if have_PyModule_Create:
@@ -1705,7 +1742,15 @@ def compile(env, jccPath, output, moduleName, install, dist, debug, jars,
     line(out, 0, 'class InvalidArgsError(Exception):')
     line(out, 1, 'pass')
     line(out)
-    line(out, 0, '%s._set_exception_types(JavaError, InvalidArgsError)',
+    line(out, 0, 'try:')
+    line(out, 1, '_TimeoutError = TimeoutError')
+    line(out, 0, 'except NameError:')
+    line(out, 1, '_TimeoutError = EnvironmentError')
+    line(out)
+    line(out, 0, 'class JavaTimeoutError(JavaError, _TimeoutError):')
+    line(out, 1, 'pass')
+    line(out)
+    line(out, 0, '%s._set_exception_types(JavaError, InvalidArgsError, JavaTimeoutError)',
          extname)
 
     if version:
@@ -48,25 +48,56 @@ static PyObject *toSequence(U *self, Py_ssize_t lo, Py_ssize_t hi)
     return self->array.toSequence(lo, hi);
 }
 
+/* iterators fetch elements in chunks growing up to JARRAY_CHUNK */
+
 template<typename U> class _t_iterator {
 public:
     PyObject_HEAD
     U *obj;
     Py_ssize_t position;
+    PyObject *chunk;
+    Py_ssize_t chunkStart, chunkEnd, chunkSize;
 
     static void dealloc(_t_iterator *self)
     {
+        Py_XDECREF(self->chunk);
         Py_XDECREF(self->obj);
         Py_TYPE(self)->tp_free((PyObject *) self);
     }
 
     static PyObject *iternext(_t_iterator *self)
     {
-        if (self->position < (Py_ssize_t) self->obj->array.length)
-            return get<U>(self->obj, self->position++);
+        Py_ssize_t length = self->obj->array.length;
 
-        PyErr_SetNone(PyExc_StopIteration);
-        return NULL;
+        if (self->position >= length)
+        {
+            PyErr_SetNone(PyExc_StopIteration);
+            return NULL;
+        }
+
+        if (self->position >= self->chunkEnd)
+        {
+            Py_ssize_t hi = self->position + self->chunkSize;
+
+            if (hi > length)
+                hi = length;
+
+            Py_XDECREF(self->chunk);
+            self->chunk = toSequence<U>(self->obj, self->position, hi);
+            if (self->chunk == NULL)
+            {
+                self->chunkEnd = 0;
+                return NULL;
+            }
+
+            self->chunkStart = self->position;
+            self->chunkEnd = hi;
+            if (self->chunkSize < JARRAY_CHUNK)
+                self->chunkSize *= 2;
+        }
+
+        return PySequence_GetItem(self->chunk,
+                                  self->position++ - self->chunkStart);
     }
 
     static PyTypeObject *JArrayIterator;
@@ -169,6 +200,392 @@ static PyObject *str(U *self)
     return _format(self, (PyObject *(*)(PyObject *)) PyObject_Str);
 }
 
+template<typename U>
+static PyObject *iter(U *self)
+{
+    _t_iterator<U> *it =
+        PyObject_New(_t_iterator<U>, _t_iterator<U>::JArrayIterator);
+
+    if (it)
+    {
+        it->position = 0;
+        it->chunk = NULL;
+        it->chunkStart = it->chunkEnd = 0;
+        it->chunkSize = 16;
+        it->obj = self; Py_INCREF((PyObject *) self);
+    }
+
+    return (PyObject *) it;
+}
+
+/* PEP 3118 buffers over the elements of primitive arrays, format is NULL
+ * for the arrays of objects and strings which don't export any.
+ */
+
+template<typename T> class jarray_buffer {
+public:
+    static const char *format() { return NULL; }
+    static jarray newArray(JNIEnv *vm_env, Py_ssize_t n)
+    {
+        return NULL;
+    }
+    static void *get(JNIEnv *vm_env, jarray array, jboolean *isCopy)
+    {
+        return NULL;
+    }
+    static void release(JNIEnv *vm_env, jarray array, void *elts, jint mode)
+    {
+    }
+    static void getRegion(JNIEnv *vm_env, jarray array, Py_ssize_t lo,
+                          Py_ssize_t n, T *elts)
+    {
+    }
+    static void set(JNIEnv *vm_env, jarray array, Py_ssize_t lo,
+                    Py_ssize_t n, const T *elts)
+    {
+    }
+};
+
+#define DEFINE_JARRAY_BUFFER(T, NAME, FORMAT)                              \
+template<> class jarray_buffer<T> {                                        \
+public:                                                                    \
+    static const char *format() { return FORMAT; }                         \
+    static jarray newArray(JNIEnv *vm_env, Py_ssize_t n)                   \
+    {                                                                      \
+        return vm_env->New##NAME##Array((jsize) n);                        \
+    }                                                                      \
+    static void *get(JNIEnv *vm_env, jarray array, jboolean *isCopy)       \
+    {                                                                      \
+        return vm_env->Get##NAME##ArrayElements((T##Array) array, isCopy); \
+    }                                                                      \
+    static void release(JNIEnv *vm_env, jarray array, void *elts, jint mode) \
+    {                                                                      \
+        vm_env->Release##NAME##ArrayElements((T##Array) array, (T *) elts, \
+                                             mode);                        \
+    }                                                                      \
+    static void getRegion(JNIEnv *vm_env, jarray array, Py_ssize_t lo,     \
+                          Py_ssize_t n, T *elts)                           \
+    {                                                                      \
+        vm_env->Get##NAME##ArrayRegion((T##Array) array, (jsize) lo,       \
+                                       (jsize) n, elts);                   \
+    }                                                                      \
+    static void set(JNIEnv *vm_env, jarray array, Py_ssize_t lo,           \
+                    Py_ssize_t n, const T *elts)                           \
+    {                                                                      \
+        vm_env->Set##NAME##ArrayRegion((T##Array) array, (jsize) lo,       \
+                                       (jsize) n, elts);                   \
+    }                                                                      \
+};
+
+DEFINE_JARRAY_BUFFER(jboolean, Boolean, "?")
+DEFINE_JARRAY_BUFFER(jbyte, Byte, "b")
+DEFINE_JARRAY_BUFFER(jchar, Char, "H")
+DEFINE_JARRAY_BUFFER(jshort, Short, "h")
+DEFINE_JARRAY_BUFFER(jint, Int, "i")
+DEFINE_JARRAY_BUFFER(jlong, Long, "q")
+DEFINE_JARRAY_BUFFER(jfloat, Float, "f")
+DEFINE_JARRAY_BUFFER(jdouble, Double, "d")
+
+/* copies elements between arrays of the same type in Java */
+static void arraycopy(jarray src, Py_ssize_t srcPos,
+                      jarray dst, Py_ssize_t dstPos, Py_ssize_t count)
+{
+    static jclass _System = NULL;
+    static jmethodID _arraycopy = NULL;
+    JNIEnv *vm_env = env->get_vm_env();
+
+    if (_arraycopy == NULL)
+    {
+        jclass cls = vm_env->FindClass("java/lang/System");
+        jmethodID mid = vm_env->GetStaticMethodID(
+            cls, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V");
+
+        _System = (jclass) vm_env->NewGlobalRef(cls);
+        vm_env->DeleteLocalRef(cls);
+        _arraycopy = mid;
+    }
+
+    vm_env->CallStaticVoidMethod(_System, _arraycopy, src, (jint) srcPos,
+                                 dst, (jint) dstPos, (jint) count);
+    if (vm_env->ExceptionCheck())
+        PyErr_SetJavaError();
+}
+
+/* allocates an array of n elements of the same type as array */
+template<typename T>
+static jarray newArray(jarray array, Py_ssize_t n)
+{
+    return jarray_buffer<T>::newArray(env->get_vm_env(), n);
+}
+
+/* returns a local reference to the component class of an array class or
+ * NULL for another class
+ */
+static jclass componentClass(JNIEnv *vm_env, jclass cls)
+{
+    static jmethodID _getComponentType = NULL;
+
+    if (_getComponentType == NULL)
+    {
+        jclass cls = vm_env->FindClass("java/lang/Class");
+
+        _getComponentType = vm_env->GetMethodID(cls, "getComponentType",
+                                                "()Ljava/lang/Class;");
+        vm_env->DeleteLocalRef(cls);
+    }
+
+    return (jclass) vm_env->CallObjectMethod(cls, _getComponentType);
+}
+
+/* returns a local reference to the component class of an object array */
+static jclass componentType(jarray array)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass cls = vm_env->GetObjectClass(array);
+    jclass result = componentClass(vm_env, cls);
+
+    vm_env->DeleteLocalRef(cls);
+
+    return result;
+}
+
+/* allocates an array of n elements of the component class of array */
+static jarray newObjectArray(jarray array, Py_ssize_t n)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass cls = componentType(array);
+    jarray result = NULL;
+
+    if (cls != NULL)
+    {
+        result = vm_env->NewObjectArray((jsize) n, cls, NULL);
+        vm_env->DeleteLocalRef(cls);
+    }
+
+    return result;
+}
+
+template<> jarray newArray<jobject>(jarray array, Py_ssize_t n)
+{
+    return newObjectArray(array, n);
+}
+
+template<> jarray newArray<jstring>(jarray array, Py_ssize_t n)
+{
+    return newObjectArray(array, n);
+}
+
+/* returns arg if it's an array of the same type as self or else converts
+ * arg, a sequence or iterable, into one
+ */
+template<typename T, typename U>
+static JArray<T> asArray(U *self, PyObject *arg)
+{
+    if (PyObject_TypeCheck(arg, Py_TYPE(self)))
+        return ((U *) arg)->array;
+
+    if (PySequence_Check(arg))
+        return JArray<T>(arg);
+
+    PyObject *fast = PySequence_Fast(arg, "not a sequence");
+
+    if (fast == NULL)
+        return JArray<T>((jobject) NULL);
+
+    JArray<T> array = JArray<T>(fast);
+
+    Py_DECREF(fast);
+    return array;
+}
+
+/* wraps array like self, consuming the local reference */
+template<typename T, typename U>
+static PyObject *wrapArray(U *self, jarray array)
+{
+    return JArray<T>((jobject) array).wrap();
+}
+
+template<typename T> class _t_jarrayslice;
+
+template<typename V>
+static int compareValues(V v0, V v1, int op)
+{
+    switch (op) {
+      case Py_LT: return v0 < v1;
+      case Py_LE: return v0 <= v1;
+      case Py_EQ: return v0 == v1;
+      case Py_NE: return v0 != v1;
+      case Py_GT: return v0 > v1;
+      case Py_GE: return v0 >= v1;
+    }
+
+    return 0;
+}
+
+/* returns the index of the first of n elements that differ between two
+ * arrays of a primitive type, or n, comparing them in chunks
+ */
+template<typename T>
+static Py_ssize_t mismatch(jarray a0, Py_ssize_t pos0,
+                           jarray a1, Py_ssize_t pos1, Py_ssize_t n)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    char code = jarray_buffer<T>::format()[0];
+    T buf0[JARRAY_CHUNK], buf1[JARRAY_CHUNK];
+
+    for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+        Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
+
+        jarray_buffer<T>::getRegion(vm_env, a0, pos0 + lo, count, buf0);
+        jarray_buffer<T>::getRegion(vm_env, a1, pos1 + lo, count, buf1);
+
+        /* equal bits aren't equal floats for NaN, nor different bits
+         * different floats for 0.0 and -0.0
+         */
+        if (code != 'f' && code != 'd' &&
+            !memcmp(buf0, buf1, count * sizeof(T)))
+            continue;
+
+        for (Py_ssize_t i = 0; i < count; i++)
+            if (!(buf0[i] == buf1[i]))
+                return lo + i;
+    }
+
+    return n;
+}
+
+/* compares ranges of two arrays of the same primitive type like sequences */
+template<typename T>
+static PyObject *compareArrays(jarray a0, Py_ssize_t pos0, Py_ssize_t s0,
+                               jarray a1, Py_ssize_t pos1, Py_ssize_t s1,
+                               int op)
+{
+    PyObject *result;
+    int cmp;
+
+    if (s0 != s1 && (op == Py_EQ || op == Py_NE))
+        cmp = op == Py_NE;
+    else
+    {
+        Py_ssize_t n = s0 < s1 ? s0 : s1;
+        Py_ssize_t i = mismatch<T>(a0, pos0, a1, pos1, n);
+
+        if (i < n)
+        {
+            JNIEnv *vm_env = env->get_vm_env();
+            T v0, v1;
+
+            jarray_buffer<T>::getRegion(vm_env, a0, pos0 + i, 1, &v0);
+            jarray_buffer<T>::getRegion(vm_env, a1, pos1 + i, 1, &v1);
+            cmp = compareValues(v0, v1, op);
+        }
+        else
+            cmp = compareValues(s0, s1, op);
+    }
+
+    result = cmp ? Py_True : Py_False;
+    Py_INCREF(result);
+
+    return result;
+}
+
+/* Looks for value among the elements lo to hi of an array of a primitive
+ * type, converting it once and scanning the array in chunks. Returns 0
+ * when value doesn't convert to an element it's equal to, leaving the
+ * search to find(), -1 on error and 1 otherwise with index set to the
+ * position found or -1.
+ */
+template<typename T>
+static int scan(const JArray<T> &array, PyObject *value,
+                Py_ssize_t lo, Py_ssize_t hi, Py_ssize_t *index)
+{
+    JArray<T> needle(&value, 1);
+
+    if (PyErr_Occurred())
+    {
+        PyErr_Clear();
+        return 0;
+    }
+
+    PyObject *item = needle.get(0);
+    int eq;
+
+    if (item == NULL)
+        return -1;
+
+    eq = PyObject_RichCompareBool(item, value, Py_EQ);
+    Py_DECREF(item);
+    if (eq <= 0)
+        return eq;
+
+    JNIEnv *vm_env = env->get_vm_env();
+    T v = needle[0];
+    T buf[JARRAY_CHUNK];
+
+    for (Py_ssize_t i = lo; i < hi; i += JARRAY_CHUNK) {
+        Py_ssize_t count = hi - i < JARRAY_CHUNK ? hi - i : JARRAY_CHUNK;
+
+        jarray_buffer<T>::getRegion(vm_env, (jarray) array.this$, i, count,
+                                    buf);
+        for (Py_ssize_t j = 0; j < count; j++) {
+            if (buf[j] == v)
+            {
+                *index = i + j;
+                return 1;
+            }
+        }
+    }
+
+    *index = -1;
+    return 1;
+}
+
+template<> int scan(const JArray<jobject> &array, PyObject *value,
+                    Py_ssize_t lo, Py_ssize_t hi, Py_ssize_t *index)
+{
+    return 0;
+}
+
+template<> int scan(const JArray<jstring> &array, PyObject *value,
+                    Py_ssize_t lo, Py_ssize_t hi, Py_ssize_t *index)
+{
+    return 0;
+}
+
+/* returns the index of value among the elements lo to hi, -1 when it's
+ * not found and -2 on error
+ */
+template<typename T, typename U>
+static Py_ssize_t find(U *self, PyObject *value, Py_ssize_t lo, Py_ssize_t hi)
+{
+    Py_ssize_t index;
+
+    switch (scan<T>(self->array, value, lo, hi, &index)) {
+      case -1:
+        return -2;
+      case 1:
+        return index;
+    }
+
+    for (index = lo; index < hi; index++) {
+        PyObject *item = get<U>(self, index);
+        int eq;
+
+        if (item == NULL)
+            return -2;
+
+        eq = PyObject_RichCompareBool(item, value, Py_EQ);
+        Py_DECREF(item);
+
+        if (eq < 0)
+            return -2;
+        if (eq)
+            return index;
+    }
+
+    return -1;
+}
+
 template<typename U>
 static int _compare(U *self, PyObject *value, int i0, int i1, int op, int *cmp)
 {
@@ -193,12 +610,38 @@ static int _compare(U *self, PyObject *value, int i0, int i1, int op, int *cmp)
     return 0;
 }
 
-template<typename U>
-static PyObject *richcompare(U *self, PyObject *value, int op)
+/* compares the length elements of an array starting at offset */
+template<typename T, typename U>
+static PyObject *_richcompare(U *self, Py_ssize_t offset, Py_ssize_t length,
+                              PyObject *value, int op)
 {
     PyObject *result = NULL;
     int s0, s1;
 
+    if (jarray_buffer<T>::format() != NULL)
+    {
+        if (PyObject_TypeCheck(value, Py_TYPE(self)))
+            return compareArrays<T>((jarray) self->array.this$,
+                                    offset, length,
+                                    (jarray) ((U *) value)->array.this$, 0,
+                                    ((U *) value)->array.length, op);
+
+        PyTypeObject *slice = _t_jarrayslice<T>::JArraySlice;
+
+        if (slice != NULL && PyObject_TypeCheck(value, slice))
+        {
+            _t_jarrayslice<T> *view = (_t_jarrayslice<T> *) value;
+
+            if (_t_jarrayslice<T>::check(view) < 0)
+                return NULL;
+
+            return compareArrays<T>((jarray) self->array.this$,
+                                    offset, length,
+                                    (jarray) view->obj->array.this$,
+                                    view->start, view->length, op);
+        }
+    }
+
     if (!PySequence_Check(value))
     {
         Py_INCREF(Py_NotImplemented);
@@ -210,7 +653,7 @@ static PyObject *richcompare(U *self, PyObject *value, int op)
         return NULL;
 
     s0 = PySequence_Fast_GET_SIZE(value);
-    s1 = self->array.length;
+    s1 = length;
 
     if (s1 < 0)
     {
@@ -228,35 +671,25 @@ static PyObject *richcompare(U *self, PyObject *value, int op)
 
     if (!result)
     {
-        int i0, i1, cmp = 1;
+        int i, cmp = 1;
 
-        for (i0 = 0, i1 = 0; i0 < s0 && i1 < s1 && cmp; i0++, i1++) {
-            if (_compare(self, value, i0, i1, Py_EQ, &cmp) < 0)
+        for (i = 0; i < s0 && i < s1; i++) {
+            if (_compare(self, value, offset + i, i, Py_EQ, &cmp) < 0)
             {
                 Py_DECREF(value);
                 return NULL;
             }                
+            if (!cmp)
+                break;
         }
 
         if (cmp)
-        {
-            switch (op) {
-              case Py_LT: cmp = s0 < s1; break;
-              case Py_LE: cmp = s0 <= s1; break;
-              case Py_EQ: cmp = s0 == s1; break;
-              case Py_NE: cmp = s0 != s1; break;
-              case Py_GT: cmp = s0 > s1; break;
-              case Py_GE: cmp = s0 >= s1; break;
-              default: cmp = 0;
-            }
-
-            result = cmp ? Py_True : Py_False;
-        }
+            result = compareValues(s1, s0, op) ? Py_True : Py_False;
         else if (op == Py_EQ)
             result = Py_False;
         else if (op == Py_NE)
             result = Py_True;
-        else if (_compare(self, value, i0, i1, op, &cmp) < 0)
+        else if (_compare(self, value, offset + i, i, op, &cmp) < 0)
         {
             Py_DECREF(value);
             return NULL;
@@ -270,19 +703,10 @@ static PyObject *richcompare(U *self, PyObject *value, int op)
     return result;
 }
 
-template<typename U>
-static PyObject *iter(U *self)
+template<typename T, typename U>
+static PyObject *richcompare(U *self, PyObject *value, int op)
 {
-    _t_iterator<U> *it =
-        PyObject_New(_t_iterator<U>, _t_iterator<U>::JArrayIterator);
-
-    if (it)
-    {
-        it->position = 0;
-        it->obj = self; Py_INCREF((PyObject *) self);
-    }
-
-    return (PyObject *) it;
+    return _richcompare<T,U>(self, 0, self->array.length, value, op);
 }
 
 template<typename U>
@@ -300,190 +724,1414 @@ static PyObject *seq_get(U *self, Py_ssize_t n)
     return get<U>(self, n);
 }
 
-template<typename U>
+template<typename T, typename U>
 static int seq_contains(U *self, PyObject *value)
 {
-    return 0;
+    Py_ssize_t index = find<T,U>(self, value, 0, self->array.length);
+
+    return index < -1 ? -1 : index >= 0;
 }
 
-template<typename U>
+template<typename T, typename U>
+static PyObject *index_(U *self, PyObject *args)
+{
+    Py_ssize_t length = self->array.length;
+    Py_ssize_t lo = 0, hi = length;
+    PyObject *value;
+
+    if (!PyArg_ParseTuple(args, "O|nn", &value, &lo, &hi))
+        return NULL;
+
+    if (lo < 0) lo = length + lo;
+    if (lo < 0) lo = 0;
+    else if (lo > length) lo = length;
+    if (hi < 0) hi = length + hi;
+    if (hi < 0) hi = 0;
+    else if (hi > length) hi = length;
+
+    Py_ssize_t i = lo < hi ? find<T,U>(self, value, lo, hi) : -1;
+
+    if (i == -1)
+        PyErr_SetObject(PyExc_ValueError, value);
+    if (i < 0)
+        return NULL;
+
+    return PyLong_FromSsize_t(i);
+}
+
+/* concatenates the length elements of an array starting at offset and arg */
+template<typename T, typename U>
+static PyObject *_concat(U *self, Py_ssize_t offset, Py_ssize_t length,
+                         PyObject *arg)
+{
+    JArray<T> array = asArray<T,U>(self, arg);
+
+    if (PyErr_Occurred())
+        return NULL;
+
+    if (array.length > INT_MAX - length)
+    {
+        PyErr_SetString(PyExc_OverflowError, "array too large");
+        return NULL;
+    }
+
+    jarray result = newArray<T>((jarray) self->array.this$,
+                                length + array.length);
+    PyObject *obj = NULL;
+
+    if (result == NULL)
+        return PyErr_SetJavaError();
+
+    arraycopy((jarray) self->array.this$, offset, result, 0, length);
+    if (!PyErr_Occurred())
+        arraycopy((jarray) array.this$, 0, result, length, array.length);
+    if (!PyErr_Occurred())
+        obj = wrapArray<T,U>(self, result);
+    else
+        env->get_vm_env()->DeleteLocalRef(result);
+
+    return obj;
+}
+
+template<typename T, typename U>
 static PyObject *seq_concat(U *self, PyObject *arg)
 {
-    PyObject *list = toSequence<U>(self);
+    return _concat<T,U>(self, 0, self->array.length, arg);
+}
+
+/* repeats the length elements of an array starting at offset n times */
+template<typename T, typename U>
+static PyObject *_repeat(U *self, Py_ssize_t offset, Py_ssize_t length,
+                         Py_ssize_t n)
+{
+    if (n < 0)
+        n = 0;
+
+    if (length > 0 && n > INT_MAX / length)
+    {
+        PyErr_SetString(PyExc_OverflowError, "array too large");
+        return NULL;
+    }
+
+    Py_ssize_t size = length * n;
+    jarray result = newArray<T>((jarray) self->array.this$, size);
+    PyObject *obj = NULL;
+
+    if (result == NULL)
+        return PyErr_SetJavaError();
+
+    /* copies the array once then doubles the copied range */
+    if (size > 0)
+        arraycopy((jarray) self->array.this$, offset, result, 0, length);
+    for (Py_ssize_t done = length; done < size && !PyErr_Occurred();
+         done *= 2)
+        arraycopy(result, 0, result, done,
+                  done < size - done ? done : size - done);
+    if (!PyErr_Occurred())
+        obj = wrapArray<T,U>(self, result);
+    else
+        env->get_vm_env()->DeleteLocalRef(result);
+
+    return obj;
+}
+
+template<typename T, typename U>
+static PyObject *seq_repeat(U *self, Py_ssize_t n)
+{
+    return _repeat<T,U>(self, 0, self->array.length, n);
+}
+
+template<typename U>
+static PyObject *seq_getslice(U *self, Py_ssize_t lo, Py_ssize_t hi)
+{
+    return toSequence<U>(self, lo, hi);
+}
+
+template<typename U>
+static int seq_set(U *self, Py_ssize_t n, PyObject *value)
+{
+    return self->array.set(n, value);
+}
+
+template<typename T, typename U>
+static int seq_setslice(U *self, Py_ssize_t lo, Py_ssize_t hi, PyObject *values)
+{
+    Py_ssize_t length = self->array.length;
+
+    if (values == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "array size cannot change");
+        return -1;
+    }
+            
+    if (lo < 0) lo = length + lo;
+    if (lo < 0) lo = 0;
+    else if (lo > length) lo = length;
+    if (hi < 0) hi = length + hi;
+    if (hi < 0) hi = 0;
+    else if (hi > length) hi = length;
+    if (lo > hi) lo = hi;
+
+    JArray<T> array = asArray<T,U>(self, values);
+
+    if (PyErr_Occurred())
+        return -1;
+
+    if (array.length != hi - lo)
+    {
+        PyErr_SetString(PyExc_ValueError, "array size cannot change");
+        return -1;
+    }
+
+    arraycopy((jarray) array.this$, 0, (jarray) self->array.this$, lo,
+              array.length);
+
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+/* returns 1 for an index in start, 0 for a slice, -1 otherwise */
+static int subscript_key(PyObject *key, Py_ssize_t length,
+                         Py_ssize_t *start, Py_ssize_t *stop,
+                         Py_ssize_t *step, Py_ssize_t *count)
+{
+    if (PyIndex_Check(key))
+    {
+        *start = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (*start == -1 && PyErr_Occurred())
+            return -1;
+
+        return 1;
+    }
+
+    if (PySlice_Check(key))
+    {
+#if PY_MAJOR_VERSION >= 3
+        if (PySlice_GetIndicesEx(key, length, start, stop, step, count) < 0)
+#else
+        if (PySlice_GetIndicesEx((PySliceObject *) key, length,
+                                 start, stop, step, count) < 0)
+#endif
+            return -1;
+
+        return 0;
+    }
+
+    PyErr_SetObject(PyExc_TypeError, key);
+    return -1;
+}
+
+/* Subscripts the length elements of an array starting at offset: slices
+ * of arrays of primitive types are views, see _t_jarrayslice, others are
+ * lists.
+ */
+template<typename T, typename U>
+static PyObject *_subscript(U *self, Py_ssize_t offset, Py_ssize_t length,
+                            PyObject *key)
+{
+    Py_ssize_t start, stop, step, count;
+
+    switch (subscript_key(key, length, &start, &stop, &step, &count)) {
+      case -1:
+        return NULL;
+      case 1:
+        if (start < 0)
+            start += length;
+        if (start < 0 || start >= length)
+        {
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return NULL;
+        }
+        return get<U>(self, offset + start);
+    }
+
+    if (step == 1)
+    {
+        if (_t_jarrayslice<T>::JArraySlice != NULL)
+            return _t_jarrayslice<T>::make(self, offset + start, count);
+
+        return toSequence<U>(self, offset + start, offset + stop);
+    }
+
+    PyObject *list = PyList_New(count);
+
+    for (Py_ssize_t i = 0; list != NULL && i < count; i++) {
+        PyObject *value = get<U>(self, offset + start + i * step);
+
+        if (value == NULL)
+        {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, value);
+    }
+
+    return list;
+}
+
+template<typename T, typename U>
+static int _ass_subscript(U *self, Py_ssize_t offset, Py_ssize_t length,
+                          PyObject *key, PyObject *values)
+{
+    Py_ssize_t start, stop, step, count;
+
+    if (values == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, "array size cannot change");
+        return -1;
+    }
+
+    switch (subscript_key(key, length, &start, &stop, &step, &count)) {
+      case -1:
+        return -1;
+      case 1:
+        if (start < 0)
+            start += length;
+        if (start < 0 || start >= length)
+        {
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return -1;
+        }
+        return self->array.set(offset + start, values);
+    }
+
+    if (step == 1)
+        return seq_setslice<T,U>(self, offset + start, offset + stop, values);
+
+    PyObject *sequence = PySequence_Fast(values, "not a sequence");
+    int result = 0;
+
+    if (!sequence)
+        return -1;
+
+    if (PySequence_Fast_GET_SIZE(sequence) != count)
+    {
+        PyErr_SetString(PyExc_ValueError, "array size cannot change");
+        result = -1;
+    }
+
+    for (Py_ssize_t i = 0; result == 0 && i < count; i++)
+        result = self->array.set(offset + start + i * step,
+                                 PySequence_Fast_GET_ITEM(sequence, i));
+
+    Py_DECREF(sequence);
+    return result;
+}
+
+template<typename T, typename U>
+static PyObject *subscript(U *self, PyObject *key)
+{
+    return _subscript<T,U>(self, 0, self->array.length, key);
+}
+
+template<typename T, typename U>
+static int ass_subscript(U *self, PyObject *key, PyObject *values)
+{
+    return _ass_subscript<T,U>(self, 0, self->array.length, key, values);
+}
+
+/* the kind of the elements of a buffer format code: signed, unsigned,
+ * floating point or boolean
+ */
+static char buffer_kind(char code)
+{
+    switch (code) {
+      case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+        return 'i';
+      case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N': case 'c':
+        return 'u';
+      case 'f': case 'd':
+        return 'f';
+      case '?':
+        return '?';
+    }
+
+    return 0;
+}
+
+/* reads one element of the given kind and size, swapping bytes if asked */
+static void buffer_item(const char *item, char kind, Py_ssize_t size,
+                        bool swap, PY_LONG_LONG *ll, double *d)
+{
+    union {
+        char c[8];
+        signed char i1; unsigned char u1;
+        short i2; unsigned short u2;
+        int i4; unsigned int u4;
+        PY_LONG_LONG i8; unsigned PY_LONG_LONG u8;
+        float f4; double f8;
+    } u;
+
+    for (Py_ssize_t i = 0; i < size; i++)
+        u.c[i] = item[swap ? size - 1 - i : i];
+
+    switch (kind) {
+      case 'f':
+        *d = size == 4 ? (double) u.f4 : u.f8;
+        *ll = 0;
+        return;
+      case 'u':
+        switch (size) {
+          case 1: *ll = u.u1; break;
+          case 2: *ll = u.u2; break;
+          case 4: *ll = u.u4; break;
+          default: *ll = (PY_LONG_LONG) u.u8; break;
+        }
+        break;
+      default:
+        switch (size) {
+          case 1: *ll = u.i1; break;
+          case 2: *ll = u.i2; break;
+          case 4: *ll = u.i4; break;
+          default: *ll = u.i8; break;
+        }
+        break;
+    }
+    *d = (double) *ll;
+}
+
+/* Returns the kind of the items of a buffer, see buffer_kind(), when they
+ * convert to elements of T: integers for an integer or floating point
+ * array, floating point numbers for a floating point array, booleans for a
+ * boolean array. Returns 0 otherwise.
+ */
+template<typename T>
+static char bufferKind(Py_buffer *view, bool *swap)
+{
+    static const int one = 1;
+    const char *format = view->format != NULL ? view->format : "B";
+
+    *swap = false;
+    switch (*format) {
+      case '@': case '=':
+        format += 1;
+        break;
+      case '<':
+        *swap = *(char *) &one == 0;
+        format += 1;
+        break;
+      case '>': case '!':
+        *swap = *(char *) &one == 1;
+        format += 1;
+        break;
+    }
+
+    char kind = format[1] == '\0' ? buffer_kind(format[0]) : 0;
+    char to = buffer_kind(jarray_buffer<T>::format()[0]);
+    Py_ssize_t size = view->itemsize;
+    bool integer = kind == 'i' || kind == 'u';
+
+    if (kind == 0 ||
+        (size != 1 && size != 2 && size != 4 && size != 8) ||
+        ((to == '?' || kind == '?') && to != kind) ||
+        (to == 'u' && !(integer && size == sizeof(T))) ||
+        (to == 'i' && !integer))
+        return 0;
+
+    return kind;
+}
+
+/* Sets n elements of array from pos to the buffer items at item: with one
+ * Set<T>ArrayRegion when they have the same size and kind in native byte
+ * order, converted in chunks otherwise.
+ */
+template<typename T>
+static void setBufferItems(JNIEnv *vm_env, jarray array, Py_ssize_t pos,
+                           Py_ssize_t n, const char *item, char kind,
+                           Py_ssize_t size, bool swap)
+{
+    char to = buffer_kind(jarray_buffer<T>::format()[0]);
+    bool integer = kind == 'i' || kind == 'u';
+
+    if (!swap && size == sizeof(T) &&
+        (kind == to || (integer && (to == 'i' || to == 'u'))))
+    {
+        jarray_buffer<T>::set(vm_env, array, pos, n, (const T *) item);
+        return;
+    }
+
+    T elts[JARRAY_CHUNK];
+
+    for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+        Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
+
+        for (Py_ssize_t i = 0; i < count; i++, item += size) {
+            PY_LONG_LONG ll;
+            double d;
+
+            buffer_item(item, kind, size, swap, &ll, &d);
+            elts[i] = to == 'f' ? (T) d : (T) ll;
+        }
+
+        jarray_buffer<T>::set(vm_env, array, pos + lo, count, elts);
+    }
+}
+
+/* Fills a new primitive array with the contents of a one-dimensional,
+ * contiguous buffer whose items convert to its elements, see bufferKind().
+ * Returns 0, without error, when object doesn't export such a buffer and
+ * 1 otherwise.
+ */
+template<typename T> int fromPyBuffer(jarray array, Py_ssize_t length,
+                                      PyObject *object)
+{
+    Py_buffer view;
+
+    if (_t_jarrayslice<T>::JArraySlice != NULL &&
+        PyObject_TypeCheck(object, _t_jarrayslice<T>::JArraySlice))
+    {
+        _t_jarrayslice<T> *slice = (_t_jarrayslice<T> *) object;
+
+        if (slice->length != length)
+            return 0;
+
+        arraycopy((jarray) slice->obj->array.this$, slice->start,
+                  array, 0, length);
+        return 1;
+    }
+
+    if (!PyObject_CheckBuffer(object))
+        return 0;
+
+    if (PyObject_GetBuffer(object, &view,
+                           PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+    {
+        PyErr_Clear();
+        return 0;
+    }
+
+    bool swap;
+    char kind = bufferKind<T>(&view, &swap);
+
+    if (kind == 0 || view.ndim > 1 || view.len != length * view.itemsize)
+    {
+        PyBuffer_Release(&view);
+        return 0;
+    }
+
+    JNIEnv *vm_env = env->get_vm_env();
+
+    setBufferItems<T>(vm_env, array, 0, length, (const char *) view.buf,
+                      kind, view.itemsize, swap);
+
+    PyBuffer_Release(&view);
+    if (vm_env->ExceptionCheck())
+        PyErr_SetJavaError();
+
+    return 1;
+}
+
+/* What a buffer export keeps until release: a global reference to the
+ * array, in case the wrapper gets re-initialized meanwhile, and the shape,
+ * which must stay valid for as long as the view does.
+ */
+class jarray_export {
+public:
+    jarray array;
+    Py_ssize_t shape;
+};
+
+static JNIEnv *getbuffer_vm_env()
+{
+    JNIEnv *vm_env = env->get_vm_env();
+
+    if (vm_env == NULL)
+        PyErr_SetString(PyExc_RuntimeError,
+                        "attachCurrentThread() must be called first");
+
+    return vm_env;
+}
+
+/* A memoryview may be released by the garbage collector, on a thread that
+ * is not attached to the JVM.
+ */
+static JNIEnv *releasebuffer_vm_env()
+{
+    JNIEnv *vm_env = env->get_vm_env();
+
+    if (vm_env == NULL)
+    {
+        env->attachCurrentThread(NULL, 0);
+        vm_env = env->get_vm_env();
+    }
+
+    return vm_env;
+}
+
+static jarray_export *newExport(JNIEnv *vm_env, jarray array,
+                                Py_ssize_t length)
+{
+    jarray_export *export_ = (jarray_export *)
+        PyMem_Malloc(sizeof(jarray_export));
+
+    if (export_ == NULL)
+    {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    export_->array = (jarray) vm_env->NewGlobalRef(array);
+    export_->shape = length;
+
+    return export_;
+}
+
+static void fillView(Py_buffer *view, PyObject *self, void *buf,
+                     jarray_export *export_, Py_ssize_t itemsize,
+                     const char *format, int flags)
+{
+    view->buf = buf;
+    view->obj = self;
+    Py_INCREF(self);
+    view->len = export_->shape * itemsize;
+    view->readonly = !(flags & PyBUF_WRITABLE);
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char *) format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &export_->shape : NULL;
+    view->strides =
+        (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &view->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = export_;
+}
+
+/* The buffer is read-only unless a writable one is requested. The JVM
+ * usually hands out a copy of the elements: a read-only copy is dropped on
+ * release while a writable one is written back as a whole, overwriting any
+ * change made to the array from Java while the buffer was held.
+ */
+template<typename T, typename U>
+static int getbuffer(U *self, Py_buffer *view, int flags)
+{
+    jarray array = (jarray) self->array.this$;
+
+    view->obj = NULL;
+    if (array == NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "null array");
+        return -1;
+    }
+
+    JNIEnv *vm_env = getbuffer_vm_env();
+
+    if (vm_env == NULL)
+        return -1;
+
+    jarray_export *export_ = newExport(vm_env, array, self->array.length);
+
+    if (export_ == NULL)
+        return -1;
+
+    jboolean isCopy = 0;
+    void *elts = jarray_buffer<T>::get(vm_env, array, &isCopy);
+
+    if (elts == NULL)
+    {
+        vm_env->DeleteGlobalRef(export_->array);
+        PyMem_Free(export_);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    fillView(view, (PyObject *) self, elts, export_, sizeof(T),
+             jarray_buffer<T>::format(), flags);
+
+    return 0;
+}
+
+template<typename T, typename U>
+static void releasebuffer(U *self, Py_buffer *view)
+{
+    JNIEnv *vm_env = releasebuffer_vm_env();
+    jarray_export *export_ = (jarray_export *) view->internal;
+
+    jarray_buffer<T>::release(vm_env, export_->array, view->buf,
+                              view->readonly ? JNI_ABORT : 0);
+    vm_env->DeleteGlobalRef(export_->array);
+    PyMem_Free(export_);
+}
+
+/* static type objects are filled in at runtime, start from a proper header */
+static void init_type_object(PyTypeObject *type)
+{
+    static PyTypeObject empty = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+    memcpy(type, &empty, sizeof(PyTypeObject));
+}
+
+/* A view over start to start + length of a primitive array, made by
+ * slicing it. Its buffer is a copy of the range, read-only unless a
+ * writable one is requested, in which case the whole range is written back
+ * on release, like the array's own buffer.
+ */
+template<typename T> class _t_jarrayslice {
+public:
+    PyObject_HEAD
+    _t_JArray<T> *obj;
+    Py_ssize_t start;
+    Py_ssize_t length;
+
+    static PyTypeObject *JArraySlice;
+    static const char *type_name;
+
+    static PyObject *make(_t_JArray<T> *obj, Py_ssize_t start,
+                          Py_ssize_t length)
+    {
+        _t_jarrayslice *self = PyObject_New(_t_jarrayslice, JArraySlice);
+
+        if (self)
+        {
+            self->obj = obj; Py_INCREF((PyObject *) obj);
+            self->start = start;
+            self->length = length;
+        }
+
+        return (PyObject *) self;
+    }
+
+    static void dealloc(_t_jarrayslice *self)
+    {
+        Py_XDECREF(self->obj);
+        Py_TYPE(self)->tp_free((PyObject *) self);
+    }
+
+    /* the array may have been re-initialized to a shorter one meanwhile */
+    static int check(_t_jarrayslice *self)
+    {
+        if (self->obj->array.this$ == NULL ||
+            self->start + self->length > self->obj->array.length)
+        {
+            PyErr_SetString(PyExc_IndexError, "view out of array range");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    static PyObject *repr(_t_jarrayslice *self)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        PyObject *list = toSequence<_t_JArray<T> >(self->obj, self->start,
+                                                   self->start + self->length);
+        PyObject *result = NULL;
+
+        if (list)
+        {
+            PyObject *r = PyObject_Repr(list);
+
+            if (r)
+            {
+                result = PyUnicode_FromFormat("JArraySlice<%s>%U",
+                                              type_name, r);
+                Py_DECREF(r);
+            }
+            Py_DECREF(list);
+        }
+
+        return result;
+    }
+
+    static Py_ssize_t seq_length(_t_jarrayslice *self)
+    {
+        return self->length;
+    }
+
+    static PyObject *seq_get(_t_jarrayslice *self, Py_ssize_t n)
+    {
+        if (n < 0 || n >= self->length)
+        {
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return NULL;
+        }
+
+        if (check(self) < 0)
+            return NULL;
+
+        return get<_t_JArray<T> >(self->obj, self->start + n);
+    }
+
+    static int seq_set(_t_jarrayslice *self, Py_ssize_t n, PyObject *value)
+    {
+        if (value == NULL)
+        {
+            PyErr_SetString(PyExc_ValueError, "array size cannot change");
+            return -1;
+        }
+
+        if (n < 0 || n >= self->length)
+        {
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return -1;
+        }
+
+        if (check(self) < 0)
+            return -1;
+
+        return self->obj->array.set(self->start + n, value);
+    }
+
+    static PyObject *subscript(_t_jarrayslice *self, PyObject *key)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        return _subscript<T, _t_JArray<T> >(self->obj, self->start,
+                                           self->length, key);
+    }
+
+    static int ass_subscript(_t_jarrayslice *self, PyObject *key,
+                             PyObject *values)
+    {
+        if (check(self) < 0)
+            return -1;
+
+        return _ass_subscript<T, _t_JArray<T> >(self->obj, self->start,
+                                                self->length, key, values);
+    }
+
+    static PyObject *richcompare(_t_jarrayslice *self, PyObject *value,
+                                 int op)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        return _richcompare<T, _t_JArray<T> >(self->obj, self->start,
+                                              self->length, value, op);
+    }
+
+    static PyObject *seq_concat(_t_jarrayslice *self, PyObject *arg)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        return _concat<T, _t_JArray<T> >(self->obj, self->start,
+                                         self->length, arg);
+    }
+
+    static PyObject *seq_repeat(_t_jarrayslice *self, Py_ssize_t n)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        return _repeat<T, _t_JArray<T> >(self->obj, self->start,
+                                         self->length, n);
+    }
+
+    static int getbuffer(_t_jarrayslice *self, Py_buffer *view, int flags)
+    {
+        jarray array = (jarray) self->obj->array.this$;
+
+        view->obj = NULL;
+        if (array == NULL)
+        {
+            PyErr_SetString(PyExc_BufferError, "null array");
+            return -1;
+        }
+
+        JNIEnv *vm_env = getbuffer_vm_env();
+
+        if (vm_env == NULL || check(self) < 0)
+            return -1;
+
+        T *elts = (T *) PyMem_Malloc(self->length * sizeof(T) + 1);
+
+        if (elts == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+
+        jarray_export *export_ = newExport(vm_env, array, self->length);
+
+        if (export_ == NULL)
+        {
+            PyMem_Free(elts);
+            return -1;
+        }
+
+        jarray_buffer<T>::getRegion(vm_env, array, self->start, self->length,
+                                    elts);
+        fillView(view, (PyObject *) self, elts, export_, sizeof(T),
+                 jarray_buffer<T>::format(), flags);
+
+        return 0;
+    }
+
+    static void releasebuffer(_t_jarrayslice *self, Py_buffer *view)
+    {
+        JNIEnv *vm_env = releasebuffer_vm_env();
+        jarray_export *export_ = (jarray_export *) view->internal;
+
+        if (!view->readonly)
+            jarray_buffer<T>::set(vm_env, export_->array, self->start,
+                                  export_->shape, (T *) view->buf);
+        vm_env->DeleteGlobalRef(export_->array);
+        PyMem_Free(export_);
+        PyMem_Free(view->buf);
+    }
+
+    /* materializes the view into a new array */
+    static PyObject *copy_(_t_jarrayslice *self)
+    {
+        if (check(self) < 0)
+            return NULL;
+
+        JNIEnv *vm_env = env->get_vm_env();
+        jarray array = jarray_buffer<T>::newArray(vm_env, self->length);
+
+        if (array == NULL)
+            return PyErr_SetJavaError();
+
+        arraycopy((jarray) self->obj->array.this$, self->start,
+                  array, 0, self->length);
+
+        JArray<T> result((jobject) array);
+
+        if (PyErr_Occurred())
+            return NULL;
+
+        return result.wrap();
+    }
+};
+
+template<typename T> PyTypeObject *_t_jarrayslice<T>::JArraySlice;
+template<typename T> const char *_t_jarrayslice<T>::type_name;
+
+template<typename T> class jarray_slice_type {
+public:
+    PySequenceMethods seq_methods;
+    PyMappingMethods map_methods;
+    PyBufferProcs buffer_methods;
+    PyTypeObject type_object;
+
+    void install(char *name, const char *type_name, PyObject *module)
+    {
+        type_object.tp_name = name;
+
+        if (PyType_Ready(&type_object) == 0)
+        {
+            Py_INCREF((PyObject *) &type_object);
+            PyModule_AddObject(module, name, (PyObject *) &type_object);
+        }
+
+        _t_jarrayslice<T>::JArraySlice = &type_object;
+        _t_jarrayslice<T>::type_name = type_name;
+    }
+
+    jarray_slice_type()
+    {
+        typedef _t_jarrayslice<T> S;
+
+        static PyMethodDef methods[] = {
+            { "copy_", (PyCFunction) S::copy_, METH_NOARGS, NULL },
+            { NULL, NULL, 0, NULL }
+        };
+
+        memset(&seq_methods, 0, sizeof(seq_methods));
+        memset(&map_methods, 0, sizeof(map_methods));
+        memset(&buffer_methods, 0, sizeof(buffer_methods));
+        init_type_object(&type_object);
+
+        seq_methods.sq_length = (lenfunc) S::seq_length;
+        seq_methods.sq_concat = (binaryfunc) S::seq_concat;
+        seq_methods.sq_repeat = (ssizeargfunc) S::seq_repeat;
+        seq_methods.sq_item = (ssizeargfunc) S::seq_get;
+        seq_methods.sq_ass_item = (ssizeobjargproc) S::seq_set;
+        map_methods.mp_length = (lenfunc) S::seq_length;
+        map_methods.mp_subscript = (binaryfunc) S::subscript;
+        map_methods.mp_ass_subscript = (objobjargproc) S::ass_subscript;
+        buffer_methods.bf_getbuffer = (getbufferproc) S::getbuffer;
+        buffer_methods.bf_releasebuffer =
+            (releasebufferproc) S::releasebuffer;
+
+        type_object.tp_basicsize = sizeof(S);
+        type_object.tp_dealloc = (destructor) S::dealloc;
+        type_object.tp_repr = (reprfunc) S::repr;
+        type_object.tp_richcompare = (richcmpfunc) S::richcompare;
+        type_object.tp_as_sequence = &seq_methods;
+        type_object.tp_as_mapping = &map_methods;
+        type_object.tp_as_buffer = &buffer_methods;
+        type_object.tp_flags = Py_TPFLAGS_DEFAULT;
+#if PY_MAJOR_VERSION < 3
+        type_object.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+        type_object.tp_doc = "JArraySlice<T> view type";
+        type_object.tp_methods = methods;
+    }
+};
+
+template<typename T> 
+static jclass initializeClass(bool getOnly)
+{
+    return env->get_vm_env()->GetObjectClass(JArray<T>((Py_ssize_t) 0).this$);
+}
+
+template<typename T> 
+static PyObject *cast_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    PyObject *arg, *clsObj;
+
+    if (!PyArg_ParseTuple(args, "O", &arg))
+        return NULL;
+
+    if (!PyObject_TypeCheck(arg, &PY_TYPE(Object)))
+    {
+        PyErr_SetObject(PyExc_TypeError, arg);
+        return NULL;
+    }
+
+    Class argCls = ((t_Object *) arg)->object.getClass();
+
+    if (!argCls.isArray())
+    {
+        PyErr_SetObject(PyExc_TypeError, arg);
+        return NULL;
+    }
+
+    clsObj = PyObject_GetAttrString((PyObject *) type, "class_");
+    if (!clsObj)
+        return NULL;
+
+    Class arrayCls = ((t_Class *) clsObj)->object;
+
+    if (!arrayCls.isAssignableFrom(argCls))
+    {
+        PyErr_SetObject(PyExc_TypeError, arg);
+        return NULL;
+    }
+
+    return JArray<T>(((t_JObject *) arg)->object.this$).wrap();
+}
+
+template<typename T> 
+static PyObject *wrapfn_(const jobject &object) {
+    return JArray<T>(object).wrap();
+}
+
+template<typename T> 
+static PyObject *instance_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    PyObject *arg, *clsObj;
+
+    if (!PyArg_ParseTuple(args, "O", &arg))
+        return NULL;
+
+    if (!PyObject_TypeCheck(arg, &PY_TYPE(Object)))
+        Py_RETURN_FALSE;
+
+    Class argCls = ((t_Object *) arg)->object.getClass();
+
+    if (!argCls.isArray())
+        Py_RETURN_FALSE;
+
+    clsObj = PyObject_GetAttrString((PyObject *) type, "class_");
+    if (!clsObj)
+        return NULL;
+
+    Class arrayCls = ((t_Class *) clsObj)->object;
+
+    if (!arrayCls.isAssignableFrom(argCls))
+        Py_RETURN_FALSE;
+
+    Py_RETURN_TRUE;
+}
+
+template<typename T> 
+static PyObject *assignable_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return instance_<T>(type, args, kwds);
+}
+
+/* N-dimensional arrays are arrays of objects down to rows of elements */
+
+#define JARRAY_MAX_DIMS 255
+
+/* fills classes[k] with the class of the arrays of k + 1 dimensions of T */
+template<typename T>
+static bool arrayClasses(JNIEnv *vm_env, jclass *classes, int count)
+{
+    for (int k = 0; k < count; k++) {
+        if (k == 0)
+            classes[k] = initializeClass<T>(false);
+        else
+        {
+            jobjectArray array =
+                vm_env->NewObjectArray(0, classes[k - 1], NULL);
+
+            classes[k] = array ? vm_env->GetObjectClass(array) : NULL;
+            vm_env->DeleteLocalRef(array);
+        }
+
+        if (classes[k] == NULL)
+        {
+            while (k-- > 0)
+                vm_env->DeleteLocalRef(classes[k]);
+            PyErr_SetJavaError();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* builds the arrays for dimension dim of a C-contiguous buffer, rows of
+ * the last dimension set in one Set<T>ArrayRegion each
+ */
+template<typename T>
+static jobject fromBufferRows(JNIEnv *vm_env, jclass *classes,
+                              Py_buffer *view, int dim, const char **item,
+                              char kind, bool swap)
+{
+    Py_ssize_t n = view->shape[dim];
+
+    if (dim == view->ndim - 1)
+    {
+        jarray row = jarray_buffer<T>::newArray(vm_env, n);
+
+        if (row != NULL)
+        {
+            setBufferItems<T>(vm_env, row, 0, n, *item, kind,
+                              view->itemsize, swap);
+            *item += n * view->itemsize;
+        }
+
+        return row;
+    }
+
+    jobjectArray array =
+        vm_env->NewObjectArray((jsize) n, classes[view->ndim - dim - 2], NULL);
+
+    for (Py_ssize_t i = 0; array != NULL && i < n; i++) {
+        jobject row = fromBufferRows<T>(vm_env, classes, view, dim + 1,
+                                        item, kind, swap);
+
+        if (row == NULL)
+        {
+            vm_env->DeleteLocalRef(array);
+            return NULL;
+        }
+
+        vm_env->SetObjectArrayElement(array, (jsize) i, row);
+        vm_env->DeleteLocalRef(row);
+    }
+
+    return array;
+}
+
+template<> jobject fromBufferRows<jstring>(JNIEnv *vm_env, jclass *classes,
+                                           Py_buffer *view, int dim,
+                                           const char **item,
+                                           char kind, bool swap)
+{
+    return NULL;
+}
+
+/* builds arrays of depth dimensions from nested sequences, rows of the
+ * last dimension converted like JArray<T>(row)
+ */
+template<typename T>
+static jobject fromNested(JNIEnv *vm_env, jclass *classes, PyObject *obj,
+                          int depth)
+{
+    if (!PySequence_Check(obj))
+    {
+        PyErr_SetObject(PyExc_TypeError, obj);
+        return NULL;
+    }
+
+    if (depth == 1)
+    {
+        JArray<T> row(obj);
+
+        if (PyErr_Occurred())
+            return NULL;
+
+        return vm_env->NewLocalRef(row.this$);
+    }
+
+    PyObject *fast = PySequence_Fast(obj, "not a sequence");
+
+    if (fast == NULL)
+        return NULL;
+
+    jobjectArray array;
+
+    Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(obj);
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+    array = vm_env->NewObjectArray((jsize) n, classes[depth - 2], NULL);
+    if (array == NULL)
+        PyErr_SetJavaError();
+
+    for (Py_ssize_t i = 0; array != NULL && i < n; i++) {
+        jobject row = fromNested<T>(vm_env, classes,
+                                    PySequence_Fast_GET_ITEM(fast, i),
+                                    depth - 1);
+
+        if (row == NULL)
+        {
+            vm_env->DeleteLocalRef(array);
+            array = NULL;
+            break;
+        }
+
+        vm_env->SetObjectArrayElement(array, (jsize) i, row);
+        vm_env->DeleteLocalRef(row);
+    }
+    Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+
+    Py_DECREF(fast);
+
+    return array;
+}
+
+/* counts the levels of sequences down the first items of obj, a bytes
+ * object being a row of an array of bytes but not a level otherwise
+ */
+template<typename T>
+static int nestedDepth(PyObject *obj)
+{
+    const char *format = jarray_buffer<T>::format();
+    bool bytes = format != NULL && format[0] == 'b';
+    int depth = 0;
+
+    Py_INCREF(obj);
+    while (PySequence_Check(obj) && !PyUnicode_Check(obj) &&
+           (bytes || !PyBytes_Check(obj))) {
+        depth += 1;
+        if (PyBytes_Check(obj) || PySequence_Size(obj) <= 0)
+            break;
+
+        PyObject *item = PySequence_GetItem(obj, 0);
+
+        Py_DECREF(obj);
+        if (item == NULL)
+        {
+            PyErr_Clear();
+            return depth;
+        }
+        obj = item;
+    }
+    Py_DECREF(obj);
+    PyErr_Clear();
+
+    return depth;
+}
+
+/* Builds an array of T of as many dimensions as a C-contiguous buffer
+ * with all its rows made natively, or as levels of nested sequences down
+ * to rows of elements. Arrays of more than one dimension are returned as
+ * arrays of objects.
+ */
+template<typename T>
+static PyObject *nested_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass classes[JARRAY_MAX_DIMS];
+    jobject array = NULL;
+    bool isBuffer = false, swap = false;
+    char kind = 0;
+    Py_buffer view;
+    PyObject *obj;
+    int depth;
+
+    if (!PyArg_ParseTuple(args, "O", &obj))
+        return NULL;
+
+    if (jarray_buffer<T>::format() != NULL && PyObject_CheckBuffer(obj) &&
+        PyObject_GetBuffer(obj, &view,
+                           PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0)
+    {
+        kind = bufferKind<T>(&view, &swap);
+        isBuffer = kind != 0 && view.ndim >= 1;
+        if (!isBuffer)
+            PyBuffer_Release(&view);
+    }
 
-    if (list != NULL &&
-        PyList_Type.tp_as_sequence->sq_inplace_concat(list, arg) < 0)
+    if (isBuffer)
+        depth = view.ndim;
+    else
     {
-        Py_DECREF(list);
-        return NULL;
+        PyErr_Clear();
+        depth = nestedDepth<T>(obj);
     }
 
-    return list;
-}
+    if (depth == 0)
+        PyErr_SetObject(PyExc_TypeError, obj);
+    else if (depth > JARRAY_MAX_DIMS)
+        PyErr_SetString(PyExc_ValueError, "too many dimensions");
+    else if (arrayClasses<T>(vm_env, classes, depth - 1))
+    {
+        if (isBuffer)
+        {
+            const char *item = (const char *) view.buf;
 
-template<typename U>
-static PyObject *seq_repeat(U *self, Py_ssize_t n)
-{
-    PyObject *list = toSequence<U>(self);
+            array = fromBufferRows<T>(vm_env, classes, &view, 0, &item,
+                                      kind, swap);
+            if (array == NULL || vm_env->ExceptionCheck())
+            {
+                vm_env->DeleteLocalRef(array);
+                array = NULL;
+                PyErr_SetJavaError();
+            }
+        }
+        else
+            array = fromNested<T>(vm_env, classes, obj, depth);
 
-    if (list != NULL &&
-        PyList_Type.tp_as_sequence->sq_inplace_repeat(list, n) < 0)
-    {
-        Py_DECREF(list);
-        return NULL;
+        for (int k = 0; k < depth - 1; k++)
+            vm_env->DeleteLocalRef(classes[k]);
     }
 
-    return list;
-}
+    if (isBuffer)
+        PyBuffer_Release(&view);
 
-template<typename U>
-static PyObject *seq_getslice(U *self, Py_ssize_t lo, Py_ssize_t hi)
-{
-    return toSequence<U>(self, lo, hi);
+    if (array == NULL)
+        return NULL;
+
+    /* the wrapper consumes the local reference */
+    return depth == 1
+        ? JArray<T>(array).wrap() : JArray<jobject>(array).wrap(NULL);
 }
 
-template<typename U>
-static int seq_set(U *self, Py_ssize_t n, PyObject *value)
+/* arrays of objects are built by their constructor from a class */
+template<> PyObject *nested_<jobject>(PyTypeObject *type, PyObject *args,
+                                      PyObject *kwds)
 {
-    return self->array.set(n, value);
+    PyErr_SetObject(PyExc_TypeError, (PyObject *) type);
+    return NULL;
 }
 
-template<typename U>
-static int seq_setslice(U *self, Py_ssize_t lo, Py_ssize_t hi, PyObject *values)
+/* copies the rows of a rectangular N-dimensional array into elts */
+template<typename T>
+static int gatherRows(JNIEnv *vm_env, jarray array, Py_ssize_t *shape,
+                      int dim, int ndim, T **elts)
 {
-    Py_ssize_t length = self->array.length;
+    Py_ssize_t n = shape[dim];
 
-    if (values == NULL)
+    if (array == NULL || vm_env->GetArrayLength(array) != n)
     {
-        PyErr_SetString(PyExc_ValueError, "array size cannot change");
+        PyErr_SetString(PyExc_ValueError, "array is not rectangular");
         return -1;
     }
-            
-    if (lo < 0) lo = length + lo;
-    if (lo < 0) lo = 0;
-    else if (lo > length) lo = length;
-    if (hi < 0) hi = length + hi;
-    if (hi < 0) hi = 0;
-    else if (hi > length) hi = length;
-    if (lo > hi) lo = hi;
-
-    PyObject *sequence = PySequence_Fast(values, "not a sequence");
-    if (!sequence)
-        return -1;
-
-    Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence);
-    if (size < 0)
-        goto error;
 
-    if (size != hi - lo)
+    if (dim == ndim - 1)
     {
-        PyErr_SetString(PyExc_ValueError, "array size cannot change");
-        goto error;
-    }
+        jarray_buffer<T>::getRegion(vm_env, array, 0, n, *elts);
+        *elts += n;
 
-    for (Py_ssize_t i = lo; i < hi; i++) {
-        PyObject *value = PySequence_Fast_GET_ITEM(sequence, i - lo);
+        return 0;
+    }
 
-        if (value == NULL)
-            goto error;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        jarray row = (jarray)
+            vm_env->GetObjectArrayElement((jobjectArray) array, (jsize) i);
+        int result = gatherRows<T>(vm_env, row, shape, dim + 1, ndim, elts);
 
-        if (self->array.set(i, value) < 0)
-            goto error;
+        vm_env->DeleteLocalRef(row);
+        if (result < 0)
+            return -1;
     }
 
-    Py_DECREF(sequence);
     return 0;
-
-  error:
-    Py_DECREF(sequence);
-    return -1;
-}
-
-template<typename T> 
-static jclass initializeClass(bool getOnly)
-{
-    return env->get_vm_env()->GetObjectClass(JArray<T>((Py_ssize_t) 0).this$);
 }
 
-template<typename T> 
-static PyObject *cast_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+/* Gathers the rows of a rectangular array of ndim dimensions of T into
+ * one contiguous block, returned as a memoryview of that shape, or as a
+ * bytearray before Python 3.
+ */
+template<typename T>
+static PyObject *toBuffer(jobjectArray array, int ndim)
 {
-    PyObject *arg, *clsObj;
+    JNIEnv *vm_env = env->get_vm_env();
+    Py_ssize_t shape[JARRAY_MAX_DIMS];
+    Py_ssize_t count = 1;
+    jobject row = vm_env->NewLocalRef(array);
+
+    for (int dim = 0; dim < ndim; dim++) {
+        shape[dim] = row != NULL ? vm_env->GetArrayLength((jarray) row) : 0;
+        if (shape[dim] > 0 &&
+            count > (PY_SSIZE_T_MAX / (Py_ssize_t) sizeof(T)) / shape[dim])
+        {
+            vm_env->DeleteLocalRef(row);
+            return PyErr_NoMemory();
+        }
+        count *= shape[dim];
 
-    if (!PyArg_ParseTuple(args, "O", &arg))
-        return NULL;
+        if (dim < ndim - 1)
+        {
+            jobject next = shape[dim] > 0
+                ? vm_env->GetObjectArrayElement((jobjectArray) row, 0)
+                : NULL;
 
-    if (!PyObject_TypeCheck(arg, &PY_TYPE(Object)))
-    {
-        PyErr_SetObject(PyExc_TypeError, arg);
-        return NULL;
+            vm_env->DeleteLocalRef(row);
+            row = next;
+        }
     }
+    vm_env->DeleteLocalRef(row);
 
-    Class argCls = ((t_Object *) arg)->object.getClass();
-
-    if (!argCls.isArray())
-    {
-        PyErr_SetObject(PyExc_TypeError, arg);
-        return NULL;
-    }
+    PyObject *bytes = PyByteArray_FromStringAndSize(NULL, count * sizeof(T));
+    T *elts;
 
-    clsObj = PyObject_GetAttrString((PyObject *) type, "class_");
-    if (!clsObj)
+    if (bytes == NULL)
         return NULL;
 
-    Class arrayCls = ((t_Class *) clsObj)->object;
-
-    if (!arrayCls.isAssignableFrom(argCls))
+    elts = (T *) PyByteArray_AS_STRING(bytes);
+    if (gatherRows<T>(vm_env, (jarray) array, shape, 0, ndim, &elts) < 0)
     {
-        PyErr_SetObject(PyExc_TypeError, arg);
+        Py_DECREF(bytes);
         return NULL;
     }
 
-    return JArray<T>(((t_JObject *) arg)->object.this$).wrap();
-}
-
-template<typename T> 
-static PyObject *wrapfn_(const jobject &object) {
-    return JArray<T>(object).wrap();
-}
-
-template<typename T> 
-static PyObject *instance_(PyTypeObject *type, PyObject *args, PyObject *kwds)
-{
-    PyObject *arg, *clsObj;
+#if PY_MAJOR_VERSION >= 3
+    PyObject *view = PyMemoryView_FromObject(bytes);
+    PyObject *result;
 
-    if (!PyArg_ParseTuple(args, "O", &arg))
+    Py_DECREF(bytes);
+    if (view == NULL)
         return NULL;
 
-    if (!PyObject_TypeCheck(arg, &PY_TYPE(Object)))
-        Py_RETURN_FALSE;
-
-    Class argCls = ((t_Object *) arg)->object.getClass();
-
-    if (!argCls.isArray())
-        Py_RETURN_FALSE;
-
-    clsObj = PyObject_GetAttrString((PyObject *) type, "class_");
-    if (!clsObj)
-        return NULL;
+    /* memoryview.cast() only takes a shape without zeros */
+    if (count == 0)
+        result = PyObject_CallMethod(view, "cast", "s",
+                                     jarray_buffer<T>::format());
+    else
+    {
+        PyObject *dims = PyTuple_New(ndim);
 
-    Class arrayCls = ((t_Class *) clsObj)->object;
+        for (int dim = 0; dims != NULL && dim < ndim; dim++)
+            PyTuple_SET_ITEM(dims, dim, PyLong_FromSsize_t(shape[dim]));
 
-    if (!arrayCls.isAssignableFrom(argCls))
-        Py_RETURN_FALSE;
+        result = dims == NULL ? NULL
+            : PyObject_CallMethod(view, "cast", "sO",
+                                  jarray_buffer<T>::format(), dims);
+        Py_XDECREF(dims);
+    }
+    Py_DECREF(view);
 
-    Py_RETURN_TRUE;
+    return result;
+#else
+    return bytes;
+#endif
 }
 
-template<typename T> 
-static PyObject *assignable_(PyTypeObject *type, PyObject *args, PyObject *kwds)
+/* whether cls is the class of the arrays of T */
+template<typename T>
+static bool isArrayClass(JNIEnv *vm_env, jclass cls)
 {
-    return instance_<T>(type, args, kwds);
+    jclass arrayCls = initializeClass<T>(false);
+    bool same = vm_env->IsSameObject(cls, arrayCls) == JNI_TRUE;
+
+    vm_env->DeleteLocalRef(arrayCls);
+
+    return same;
 }
 
 template< typename T, typename U = _t_JArray<T> > class jarray_type {
 public:
     PySequenceMethods seq_methods;
+    PyMappingMethods map_methods;
+    PyBufferProcs buffer_methods;
     PyTypeObject type_object;
 
     class iterator_type {
@@ -505,10 +2153,7 @@ public:
 
         iterator_type()
         {
-            memset(&type_object, 0, sizeof(type_object));
-
-            Py_REFCNT(&type_object) = 1;
-            Py_TYPE(&type_object) = NULL;
+            init_type_object(&type_object);
             type_object.tp_basicsize = sizeof(_t_iterator<U>);
             type_object.tp_dealloc = (destructor) _t_iterator<U>::dealloc;
             type_object.tp_flags = Py_TPFLAGS_DEFAULT;
@@ -553,7 +2198,9 @@ public:
     jarray_type()
     {
         memset(&seq_methods, 0, sizeof(seq_methods));
-        memset(&type_object, 0, sizeof(type_object));
+        memset(&map_methods, 0, sizeof(map_methods));
+        memset(&buffer_methods, 0, sizeof(buffer_methods));
+        init_type_object(&type_object);
 
         static PyMethodDef methods[] = {
             { "cast_",
@@ -571,15 +2218,23 @@ public:
                                            PyObject *, PyObject *))
               assignable_<T>,
               METH_VARARGS | METH_CLASS, NULL },
+            { "index",
+              (PyCFunction) (PyObject *(*)(U *, PyObject *)) index_<T,U>,
+              METH_VARARGS, NULL },
+            { "nested_",
+              (PyCFunction) (PyObject *(*)(PyTypeObject *,
+                                           PyObject *, PyObject *))
+              nested_<T>,
+              METH_VARARGS | METH_CLASS, NULL },
             { NULL, NULL, 0, NULL }
         };
 
         seq_methods.sq_length =
             (lenfunc) (Py_ssize_t (*)(U *)) seq_length<U>;
         seq_methods.sq_concat =
-            (binaryfunc) (PyObject *(*)(U *, PyObject *)) seq_concat<U>;
+            (binaryfunc) (PyObject *(*)(U *, PyObject *)) seq_concat<T,U>;
         seq_methods.sq_repeat =
-            (ssizeargfunc) (PyObject *(*)(U *, Py_ssize_t)) seq_repeat<U>;
+            (ssizeargfunc) (PyObject *(*)(U *, Py_ssize_t)) seq_repeat<T,U>;
         seq_methods.sq_item =
             (ssizeargfunc) (PyObject *(*)(U *, Py_ssize_t)) seq_get<U>;
 #if PY_MAJOR_VERSION < 3
@@ -594,25 +2249,48 @@ public:
 #if PY_MAJOR_VERSION < 3
         seq_methods.sq_ass_slice =
             (ssizessizeobjargproc) (int (*)(U *, Py_ssize_t, Py_ssize_t,
-                                            PyObject *)) seq_setslice<U>;
+                                            PyObject *)) seq_setslice<T,U>;
 #else
         seq_methods.was_sq_ass_slice = NULL;
 #endif
         seq_methods.sq_contains =
-            (objobjproc) (int (*)(U *, PyObject *)) seq_contains<U>;
+            (objobjproc) (int (*)(U *, PyObject *)) seq_contains<T,U>;
         seq_methods.sq_inplace_concat = NULL;
         seq_methods.sq_inplace_repeat = NULL;
 
-        Py_REFCNT(&type_object) = 1;
+        map_methods.mp_length =
+            (lenfunc) (Py_ssize_t (*)(U *)) seq_length<U>;
+        map_methods.mp_subscript =
+            (binaryfunc) (PyObject *(*)(U *, PyObject *)) subscript<T,U>;
+        map_methods.mp_ass_subscript =
+            (objobjargproc) (int (*)(U *, PyObject *, PyObject *))
+            ass_subscript<T,U>;
+
         type_object.tp_basicsize = sizeof(U);
         type_object.tp_dealloc = (destructor) (void (*)(U *)) dealloc<T,U>;
         type_object.tp_repr = (reprfunc) (PyObject *(*)(U *)) repr<U>;
         type_object.tp_as_sequence = &seq_methods;
+        type_object.tp_as_mapping = &map_methods;
+        if (jarray_buffer<T>::format() != NULL)
+        {
+            buffer_methods.bf_getbuffer =
+                (getbufferproc) (int (*)(U *, Py_buffer *, int))
+                getbuffer<T,U>;
+            buffer_methods.bf_releasebuffer =
+                (releasebufferproc) (void (*)(U *, Py_buffer *))
+                releasebuffer<T,U>;
+            type_object.tp_as_buffer = &buffer_methods;
+        }
         type_object.tp_str = (reprfunc) (PyObject *(*)(U *)) str<U>;
         type_object.tp_flags = Py_TPFLAGS_DEFAULT;
+#if PY_MAJOR_VERSION < 3
+        if (type_object.tp_as_buffer != NULL)
+            type_object.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
         type_object.tp_doc = "JArray<T> wrapper type";
         type_object.tp_richcompare =
-            (richcmpfunc) (PyObject *(*)(U *, PyObject *, int)) richcompare<U>;
+            (richcmpfunc) (PyObject *(*)(U *, PyObject *, int))
+            richcompare<T,U>;
         type_object.tp_iter = (getiterfunc) (PyObject *(*)(U *)) iter<U>;
         type_object.tp_methods = methods;
         type_object.tp_base = &PY_TYPE(Object);
@@ -625,22 +2303,260 @@ public:
 template<typename T> class _t_jobjectarray : public _t_JArray<T> {
 public:
     PyObject *(*wrapfn)(const T&);
+    PyObject *wrapped;
 };
 
-template<> PyObject *get(_t_jobjectarray<jobject> *self, Py_ssize_t n)
+/* Wraps jobj, element n of the array, reusing the wrapper made for it
+ * before if that element is still the same object. Wrappers are kept in
+ * the wrapped dict, keyed by index, for the elements used so far. Like
+ * wrapfn, it consumes the local reference jobj.
+ */
+static PyObject *wrapElement(_t_jobjectarray<jobject> *self, Py_ssize_t n,
+                             jobject jobj)
 {
-    return self->array.get(n, self->wrapfn);
+    JNIEnv *vm_env = env->get_vm_env();
+    PyObject *key = PyLong_FromSsize_t(n);
+    PyObject *obj = NULL;
+
+    if (key == NULL)
+    {
+        vm_env->DeleteLocalRef(jobj);
+        return NULL;
+    }
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (self->wrapped != NULL)
+    {
+        PyObject *cached = PyDict_GetItem(self->wrapped, key);
+
+        if (cached != NULL &&
+            (cached == Py_None ? jobj == NULL :
+             jobj != NULL && vm_env->IsSameObject(
+                 ((t_JObject *) cached)->object.this$, jobj)))
+        {
+            obj = cached;
+            Py_INCREF(obj);
+        }
+    }
+    Py_END_CRITICAL_SECTION();
+
+    if (obj == NULL)
+        obj = (*(self->wrapfn ? self->wrapfn : t_Object::wrap_jobject))(jobj);
+    else
+    {
+        vm_env->DeleteLocalRef(jobj);
+        Py_DECREF(key);
+        return obj;
+    }
+
+    if (obj != NULL)
+    {
+        Py_BEGIN_CRITICAL_SECTION(self);
+        if (self->wrapped == NULL)
+            self->wrapped = PyDict_New();
+
+        if (self->wrapped == NULL ||
+            PyDict_SetItem(self->wrapped, key, obj) < 0)
+            PyErr_Clear();
+        Py_END_CRITICAL_SECTION();
+    }
+    Py_DECREF(key);
+
+    return obj;
 }
 
-template<> PyObject *toSequence(_t_jobjectarray<jobject> *self)
+template<> PyObject *get(_t_jobjectarray<jobject> *self, Py_ssize_t n)
 {
-    return self->array.toSequence(self->wrapfn);
+    if (n < 0)
+        n += self->array.length;
+
+    if (self->array.this$ == NULL || n < 0 || n >= self->array.length)
+    {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return NULL;
+    }
+
+    JNIEnv *vm_env = env->get_vm_env();
+    jobject jobj = vm_env->GetObjectArrayElement(
+        (jobjectArray) self->array.this$, (jsize) n);
+
+    if (vm_env->ExceptionCheck())
+        return PyErr_SetJavaError();
+
+    return wrapElement(self, n, jobj);
 }
 
+/* wraps elements lo to hi in bulk, in one local frame per chunk */
 template<> PyObject *toSequence(_t_jobjectarray<jobject> *self,
                                 Py_ssize_t lo, Py_ssize_t hi)
 {
-    return self->array.toSequence(lo, hi, self->wrapfn);
+    Py_ssize_t length = self->array.length;
+
+    if (self->array.this$ == NULL)
+        Py_RETURN_NONE;
+
+    if (lo < 0) lo = length + lo;
+    if (lo < 0) lo = 0;
+    else if (lo > length) lo = length;
+    if (hi < 0) hi = length + hi;
+    if (hi < 0) hi = 0;
+    else if (hi > length) hi = length;
+    if (lo > hi) lo = hi;
+
+    JNIEnv *vm_env = env->get_vm_env();
+    PyObject *list = PyList_New(hi - lo);
+
+    for (Py_ssize_t i = lo; list != NULL && i < hi; i += JARRAY_CHUNK) {
+        Py_ssize_t n = hi - i < JARRAY_CHUNK ? hi - i : JARRAY_CHUNK;
+
+        if (vm_env->PushLocalFrame((jint) n) < 0)
+        {
+            Py_DECREF(list);
+            return PyErr_SetJavaError();
+        }
+
+        for (Py_ssize_t j = i; j < i + n; j++) {
+            jobject jobj = vm_env->GetObjectArrayElement(
+                (jobjectArray) self->array.this$, (jsize) j);
+            PyObject *obj = vm_env->ExceptionCheck()
+                ? PyErr_SetJavaError() : wrapElement(self, j, jobj);
+
+            if (obj == NULL)
+            {
+                Py_CLEAR(list);
+                break;
+            }
+            PyList_SET_ITEM(list, j - lo, obj);
+        }
+
+        vm_env->PopLocalFrame(NULL);
+    }
+
+    return list;
+}
+
+template<> PyObject *toSequence(_t_jobjectarray<jobject> *self)
+{
+    return toSequence(self, 0, self->array.length);
+}
+
+static int t_JArray_jobject_traverse(_t_jobjectarray<jobject> *self,
+                                     visitproc visit, void *arg)
+{
+    Py_VISIT(self->wrapped);
+    return 0;
+}
+
+static int t_JArray_jobject_clear(_t_jobjectarray<jobject> *self)
+{
+    Py_CLEAR(self->wrapped);
+    return 0;
+}
+
+template<> void dealloc< jobject,_t_jobjectarray<jobject> >(_t_jobjectarray<jobject> *self)
+{
+    PyObject_GC_UnTrack(self);
+    Py_CLEAR(self->wrapped);
+    self->array = JArray<jobject>((jobject) NULL);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *t_JArray_jobject_tolist(_t_jobjectarray<jobject> *self)
+{
+    return toSequence(self);
+}
+
+/* gathers an array of arrays of a primitive type, see toBuffer() */
+static PyObject *t_JArray_jobject_to_buffer_(_t_jobjectarray<jobject> *self)
+{
+    jobjectArray array = (jobjectArray) self->array.this$;
+    JNIEnv *vm_env = env->get_vm_env();
+
+    if (array == NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "null array");
+        return NULL;
+    }
+
+    jclass cls = componentType((jarray) array);
+    PyObject *result;
+    int ndim = 2;
+
+    while (cls != NULL) {
+        if (isArrayClass<jboolean>(vm_env, cls))
+            result = toBuffer<jboolean>(array, ndim);
+        else if (isArrayClass<jbyte>(vm_env, cls))
+            result = toBuffer<jbyte>(array, ndim);
+        else if (isArrayClass<jchar>(vm_env, cls))
+            result = toBuffer<jchar>(array, ndim);
+        else if (isArrayClass<jdouble>(vm_env, cls))
+            result = toBuffer<jdouble>(array, ndim);
+        else if (isArrayClass<jfloat>(vm_env, cls))
+            result = toBuffer<jfloat>(array, ndim);
+        else if (isArrayClass<jint>(vm_env, cls))
+            result = toBuffer<jint>(array, ndim);
+        else if (isArrayClass<jlong>(vm_env, cls))
+            result = toBuffer<jlong>(array, ndim);
+        else if (isArrayClass<jshort>(vm_env, cls))
+            result = toBuffer<jshort>(array, ndim);
+        else
+        {
+            jclass component = componentClass(vm_env, cls);
+
+            vm_env->DeleteLocalRef(cls);
+            cls = component;
+            ndim += 1;
+            continue;
+        }
+
+        vm_env->DeleteLocalRef(cls);
+        return result;
+    }
+
+    vm_env->DeleteLocalRef(cls);
+    if (vm_env->ExceptionCheck())
+        return PyErr_SetJavaError();
+
+    PyErr_SetString(PyExc_TypeError,
+                    "not an array of arrays of a primitive type");
+    return NULL;
+}
+
+template<> JArray<jobject> asArray< jobject,_t_jobjectarray<jobject> >(_t_jobjectarray<jobject> *self, PyObject *arg)
+{
+    if (PyObject_TypeCheck(arg, Py_TYPE(self)))
+        return ((_t_jobjectarray<jobject> *) arg)->array;
+
+    PyObject *fast = arg;
+
+    if (PySequence_Check(arg))
+        Py_INCREF(arg);
+    else
+        fast = PySequence_Fast(arg, "not a sequence");
+
+    if (fast == NULL)
+        return JArray<jobject>((jobject) NULL);
+
+    jclass cls = componentType((jarray) self->array.this$);
+
+    if (cls == NULL)
+    {
+        Py_DECREF(fast);
+        PyErr_SetJavaError();
+        return JArray<jobject>((jobject) NULL);
+    }
+
+    JArray<jobject> array = JArray<jobject>(cls, fast);
+
+    env->get_vm_env()->DeleteLocalRef(cls);
+    Py_DECREF(fast);
+
+    return array;
+}
+
+template<> PyObject *wrapArray< jobject,_t_jobjectarray<jobject> >(_t_jobjectarray<jobject> *self, jarray array)
+{
+    return JArray<jobject>((jobject) array).wrap(self->wrapfn);
 }
 
 template<> int init< jobject,_t_jobjectarray<jobject> >(_t_jobjectarray<jobject> *self, PyObject *args, PyObject *kwds)
@@ -727,7 +2643,10 @@ template<> int init< jobject,_t_jobjectarray<jobject> >(_t_jobjectarray<jobject>
         return -1;
     }
 
+    Py_BEGIN_CRITICAL_SECTION(self);
     self->wrapfn = wrapfn;
+    Py_CLEAR(self->wrapped);
+    Py_END_CRITICAL_SECTION();
 
     return 0;
 }
@@ -940,17 +2859,29 @@ static jarray_type<jint> jarray_jint;
 static jarray_type<jlong> jarray_jlong;
 static jarray_type<jshort> jarray_jshort;
 
+static jarray_slice_type<jboolean> jarray_jboolean_slice;
+static jarray_slice_type<jbyte> jarray_jbyte_slice;
+static jarray_slice_type<jchar> jarray_jchar_slice;
+static jarray_slice_type<jdouble> jarray_jdouble_slice;
+static jarray_slice_type<jfloat> jarray_jfloat_slice;
+static jarray_slice_type<jint> jarray_jint_slice;
+static jarray_slice_type<jlong> jarray_jlong_slice;
+static jarray_slice_type<jshort> jarray_jshort_slice;
+
 
 PyObject *JArray<jobject>::wrap(PyObject *(*wrapfn)(const jobject&)) const
 {
     if (this$ != NULL)
     {
         _t_jobjectarray<jobject> *obj =
-            PyObject_New(_t_jobjectarray<jobject>, &jarray_jobject.type_object);
+            PyObject_GC_New(_t_jobjectarray<jobject>,
+                            &jarray_jobject.type_object);
 
         memset((void *) &(obj->array), 0, sizeof(JArray<jobject>));
         obj->array = *this;
         obj->wrapfn = wrapfn;
+        obj->wrapped = NULL;
+        PyObject_GC_Track(obj);
 
         return (PyObject *) obj;
     }
@@ -1186,6 +3117,29 @@ static PyObject *t_JArray_jbyte__get_string_(t_JArray<jbyte> *self, void *data)
     return self->array.to_string_();
 }
 
+static PyMethodDef t_JArray_jobject__methods[] = {
+    { "cast_",
+      (PyCFunction) (PyObject *(*)(PyTypeObject *, PyObject *, PyObject *))
+      cast_<jobject>,
+      METH_VARARGS | METH_CLASS, NULL },
+    { "instance_",
+      (PyCFunction) (PyObject *(*)(PyTypeObject *, PyObject *, PyObject *))
+      instance_<jobject>,
+      METH_VARARGS | METH_CLASS, NULL },
+    { "assignable_",
+      (PyCFunction) (PyObject *(*)(PyTypeObject *, PyObject *, PyObject *))
+      assignable_<jobject>,
+      METH_VARARGS | METH_CLASS, NULL },
+    { "tolist", (PyCFunction) t_JArray_jobject_tolist, METH_NOARGS, NULL },
+    { "to_buffer_", (PyCFunction) t_JArray_jobject_to_buffer_, METH_NOARGS,
+      NULL },
+    { "index",
+      (PyCFunction) (PyObject *(*)(_t_jobjectarray<jobject> *, PyObject *))
+      index_< jobject,_t_jobjectarray<jobject> >,
+      METH_VARARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
 static PyGetSetDef t_JArray_jbyte__fields[] = {
     { "bytes_", (getter) t_JArray_jbyte__get_bytes_, NULL, "", NULL },
     { "string_", (getter) t_JArray_jbyte__get_string_, NULL, "", NULL },
@@ -1207,6 +3161,12 @@ PyTypeObject *PY_TYPE(JArrayShort);
 
 void _install_jarray(PyObject *module)
 {
+    jarray_jobject.type_object.tp_methods = t_JArray_jobject__methods;
+    jarray_jobject.type_object.tp_flags |= Py_TPFLAGS_HAVE_GC;
+    jarray_jobject.type_object.tp_traverse =
+        (traverseproc) t_JArray_jobject_traverse;
+    jarray_jobject.type_object.tp_clear = (inquiry) t_JArray_jobject_clear;
+    jarray_jobject.type_object.tp_free = PyObject_GC_Del;
     jarray_jobject.install("JArray_object", "object",
                             "__JArray_object_iterator", module);
     PY_TYPE(JArrayObject) = &jarray_jobject.type_object;
@@ -1218,35 +3178,52 @@ void _install_jarray(PyObject *module)
     jarray_jboolean.install("JArray_bool", "bool",
                             "__JArray_bool_iterator", module);
     PY_TYPE(JArrayBool) = &jarray_jboolean.type_object;
+    jarray_jboolean_slice.install("JArraySlice_bool", "bool", module);
 
     jarray_jbyte.type_object.tp_getset = t_JArray_jbyte__fields;
     jarray_jbyte.install("JArray_byte", "byte",
                          "__JArray_byte_iterator", module);
     PY_TYPE(JArrayByte) = &jarray_jbyte.type_object;
+    jarray_jbyte_slice.install("JArraySlice_byte", "byte", module);
 
     jarray_jchar.install("JArray_char", "char",
                          "__JArray_char_iterator", module);
     PY_TYPE(JArrayChar) = &jarray_jchar.type_object;
+    jarray_jchar_slice.install("JArraySlice_char", "char", module);
 
     jarray_jdouble.install("JArray_double", "double",
                            "__JArray_double_iterator", module);
     PY_TYPE(JArrayDouble) = &jarray_jdouble.type_object;
+    jarray_jdouble_slice.install("JArraySlice_double", "double", module);
 
     jarray_jfloat.install("JArray_float", "float",
                           "__JArray_float_iterator", module);
     PY_TYPE(JArrayFloat) = &jarray_jfloat.type_object;
+    jarray_jfloat_slice.install("JArraySlice_float", "float", module);
 
     jarray_jint.install("JArray_int", "int",
                         "__JArray_int_iterator", module);
     PY_TYPE(JArrayInt) = &jarray_jint.type_object;
+    jarray_jint_slice.install("JArraySlice_int", "int", module);
 
     jarray_jlong.install("JArray_long", "long",
                          "__JArray_long_iterator", module);
     PY_TYPE(JArrayLong) = &jarray_jlong.type_object;
+    jarray_jlong_slice.install("JArraySlice_long", "long", module);
 
     jarray_jshort.install("JArray_short", "short",
                           "__JArray_short_iterator", module);
     PY_TYPE(JArrayShort) = &jarray_jshort.type_object;
+    jarray_jshort_slice.install("JArraySlice_short", "short", module);
 }
 
+template int fromPyBuffer<jboolean>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jbyte>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jchar>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jshort>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jint>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jlong>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jfloat>(jarray, Py_ssize_t, PyObject *);
+template int fromPyBuffer<jdouble>(jarray, Py_ssize_t, PyObject *);
+
 #endif /* PYTHON */
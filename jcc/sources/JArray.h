@@ -45,6 +45,36 @@ typedef int Py_ssize_t;
 #include "JCCEnv.h"
 #include "java/lang/Object.h"
 
+#ifdef PYTHON
+template<typename T> int fromPyBuffer(jarray array, Py_ssize_t length,
+                                      PyObject *object);
+
+/* arrays are filled and iterated in chunks of JARRAY_CHUNK elements */
+#define JARRAY_CHUNK 512
+
+/* exact ints fitting in a machine word are read inline since python 3.12 */
+inline long jarray_long(PyObject *obj)
+{
+#if PY_VERSION_HEX >= 0x030C0000 && !defined(Py_LIMITED_API)
+    if (PyLong_CheckExact(obj) &&
+        PyUnstable_Long_IsCompact((PyLongObject *) obj))
+        return (long) PyUnstable_Long_CompactValue((PyLongObject *) obj);
+#endif
+    return PyInt_AS_LONG(obj);
+}
+
+inline PY_LONG_LONG jarray_longlong(PyObject *obj)
+{
+#if PY_VERSION_HEX >= 0x030C0000 && !defined(Py_LIMITED_API)
+    if (PyLong_CheckExact(obj) &&
+        PyUnstable_Long_IsCompact((PyLongObject *) obj))
+        return (PY_LONG_LONG)
+            PyUnstable_Long_CompactValue((PyLongObject *) obj);
+#endif
+    return PyLong_AsLongLong(obj);
+}
+#endif
+
 
 template<typename T> class JArray : public java::lang::Object {
 public:
@@ -197,7 +227,8 @@ template<> class JArray<jobject> : public java::lang::Object {
             {
                 jobject jobj;
 
-                if (PyBytes_Check(obj) || PyUnicode_Check(obj))
+                if (PyBytes_Check(obj) || PyUnicode_Check(obj) ||
+                    env->isJavaStr(obj))
                     jobj = env->fromPyString(obj);
                 else if (!PyObject_TypeCheck(obj, &PY_TYPE(JObject)))
                 {
@@ -290,17 +321,7 @@ template<> class JArray<jstring> : public java::lang::Object {
         else if (hi > length) hi = length;
         if (lo > hi) lo = hi;
 
-        PyObject *list = PyList_New(hi - lo);
-
-        for (Py_ssize_t i = lo; i < hi; i++) {
-            jstring str = (jstring)
-                env->getObjectArrayElement((jobjectArray) this$, i);
-            PyObject *obj = env->fromJString(str, 1);
-
-            PyList_SET_ITEM(list, i - lo, obj);
-        }
-         
-        return list;
+        return env->fromJStrings((jobjectArray) this$, (int) lo, (int) hi);
     }
 
     PyObject *get(Py_ssize_t n)
@@ -381,6 +402,23 @@ template<> class JArray<jboolean> : public java::lang::Object {
         return arrayElements((jbooleanArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jboolean *elts;
+    public:
+        arrayRegion(jbooleanArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jboolean[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetBooleanArrayRegion(array, (jsize) lo,
+                                                     (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jboolean *() {
+            return elts;
+        }
+    };
+
     JArray<jboolean>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -396,46 +434,53 @@ template<> class JArray<jboolean> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jboolean>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewBooleanArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jboolean *buf = (jboolean *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jboolean>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (obj == Py_True || obj == Py_False)
-            {
-                buf[i] = (jboolean) (obj == Py_True);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jboolean>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewBooleanArray(length)) {
-        arrayElements elts = elements();
-        jboolean *buf = (jboolean *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetBooleanArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jboolean buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (obj == Py_True || obj == Py_False)
-                buf[i] = (jboolean) (obj == Py_True);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (obj == Py_True || obj == Py_False)
+                    buf[i] = (jboolean) (obj == Py_True);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetBooleanArrayRegion((jbooleanArray) this$,
+                                                     (jsize) lo, (jsize) count,
+                                                     buf);
         }
     }
 
@@ -458,11 +503,11 @@ template<> class JArray<jboolean> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jbooleanArray) this$, lo, hi);
         jboolean *buf = (jboolean *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++) {
-            jboolean value = buf[i];
+            jboolean value = buf[i - lo];
             PyObject *obj = value ? Py_True : Py_False;
 
             Py_INCREF(obj);
@@ -480,7 +525,7 @@ template<> class JArray<jboolean> : public java::lang::Object {
                 n = length + n;
 
             if (n >= 0 && n < length)
-                Py_RETURN_BOOL(elements()[n]);
+                Py_RETURN_BOOL((*this)[n]);
         }
 
         PyErr_SetString(PyExc_IndexError, "index out of range");
@@ -496,7 +541,10 @@ template<> class JArray<jboolean> : public java::lang::Object {
 
             if (n >= 0 && n < length)
             {
-                elements()[n] = (jboolean) PyObject_IsTrue(obj);
+                jboolean value = (jboolean) PyObject_IsTrue(obj);
+
+                env->get_vm_env()->SetBooleanArrayRegion((jbooleanArray) this$,
+                                                         (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -509,13 +557,10 @@ template<> class JArray<jboolean> : public java::lang::Object {
 #endif
 
     jboolean operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jboolean *elts = (jboolean *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jboolean value = elts[n];
+        jboolean value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetBooleanArrayRegion((jbooleanArray) this$,
+                                                 (jsize) n, 1, &value);
 
         return value;
     }
@@ -547,6 +592,23 @@ template<> class JArray<jbyte> : public java::lang::Object {
         return arrayElements((jbyteArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jbyte *elts;
+    public:
+        arrayRegion(jbyteArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jbyte[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetByteArrayRegion(array, (jsize) lo,
+                                                  (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jbyte *() {
+            return elts;
+        }
+    };
+
     JArray<jbyte>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -562,68 +624,71 @@ template<> class JArray<jbyte> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jbyte>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewByteArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jbyte *buf = (jbyte *) elts;
+
+        if (fromPyBuffer<jbyte>((jarray) this$, length, sequence))
+            return;
 
         if (PyBytes_Check(sequence))
-            memcpy(buf, PyBytes_AS_STRING(sequence), length);
+            env->get_vm_env()->SetByteArrayRegion(
+                (jbyteArray) this$, 0, (jsize) length,
+                (jbyte *) PyBytes_AS_STRING(sequence));
 /* there is no PyUnicode_AsUTF8 on python2 */
 #if PY_MAJOR_VERSION >= 3
         else if (PyUnicode_Check(sequence))
-            memcpy(buf, PyUnicode_AsUTF8(sequence), length);
+            env->get_vm_env()->SetByteArrayRegion(
+                (jbyteArray) this$, 0, (jsize) length,
+                (jbyte *) PyUnicode_AsUTF8(sequence));
 #endif
         else
-            for (Py_ssize_t i = 0; i < length; i++) {
-                PyObject *obj = PySequence_GetItem(sequence, i);
+        {
+            PyObject *fast = PySequence_Fast(sequence, "not a sequence");
+
+            if (fast != NULL)
+            {
+                Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+                Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+                setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+                Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+                Py_DECREF(fast);
+            }
+        }
+    }
+
+    JArray<jbyte>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewByteArray(length)) {
+        setItems(args, length);
+    }
+
+    /* converts items in chunks, each written with one SetByteArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jbyte buf[JARRAY_CHUNK];
+
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
+
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
 
                 if (!obj)
-                    break;
+                    return;
 
                 if (PyBytes_Check(obj) && (PyBytes_GET_SIZE(obj) == 1))
-                {
                     buf[i] = (jbyte) PyBytes_AS_STRING(obj)[0];
-                    Py_DECREF(obj);
-                }
-                else if (PyUnicode_Check(obj) && (PyUnicode_GET_SIZE(obj) == 1))
-                {
-                    buf[i] = (jbyte) PyUnicode_AS_UNICODE(obj)[0];
-                    Py_DECREF(obj);
-                }
+                else if (PyUnicode_Check(obj) && (PyUnicode_GET_LENGTH(obj) == 1))
+                    buf[i] = (jbyte) PyUnicode_READ_CHAR(obj, 0);
                 else if (PyInt_CheckExact(obj))
-                {
-                    buf[i] = (jbyte) PyInt_AS_LONG(obj);
-                    Py_DECREF(obj);
-                }
+                    buf[i] = (jbyte) jarray_long(obj);
                 else
                 {
                     PyErr_SetObject(PyExc_TypeError, obj);
-                    Py_DECREF(obj);
-                    break;
+                    return;
                 }
             }
-    }
-
-    JArray<jbyte>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewByteArray(length)) {
-        arrayElements elts = elements();
-        jbyte *buf = (jbyte *) elts;
-
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
 
-            if (!obj)
-                break;
-
-            if (PyBytes_Check(obj) && (PyBytes_GET_SIZE(obj) == 1))
-                buf[i] = (jbyte) PyBytes_AS_STRING(obj)[0];
-            else if (PyUnicode_Check(obj) && (PyUnicode_GET_SIZE(obj) == 1))
-                buf[i] = (jbyte) PyUnicode_AS_UNICODE(obj)[0];
-            else if (PyInt_CheckExact(obj))
-                buf[i] = (jbyte) PyInt_AS_LONG(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
-            }
+            env->get_vm_env()->SetByteArrayRegion((jbyteArray) this$,
+                                                  (jsize) lo, (jsize) count,
+                                                  buf);
         }
     }
 
@@ -650,12 +715,12 @@ template<> class JArray<jbyte> : public java::lang::Object {
         else if (hi > length) hi = length;
         if (lo > hi) lo = hi;
 
-        arrayElements elts = elements();
+        arrayRegion elts((jbyteArray) this$, lo, hi);
         jbyte *buf = (jbyte *) elts;
         PyObject *tuple = PyTuple_New(hi - lo);
         
         for (Py_ssize_t i = 0; i < hi - lo; i++)
-            PyTuple_SET_ITEM(tuple, i, PyInt_FromLong(buf[lo + i]));
+            PyTuple_SET_ITEM(tuple, i, PyInt_FromLong(buf[i]));
 
         return tuple;
     }
@@ -665,10 +730,14 @@ template<> class JArray<jbyte> : public java::lang::Object {
         if (this$ == NULL)
             Py_RETURN_NONE;
 
-        arrayElements elts = elements();
-        jbyte *buf = (jbyte *) elts;
+        PyObject *bytes = PyBytes_FromStringAndSize(NULL, length);
+
+        if (bytes != NULL)
+            env->get_vm_env()->GetByteArrayRegion(
+                (jbyteArray) this$, 0, (jsize) length,
+                (jbyte *) PyBytes_AS_STRING(bytes));
 
-        return PyBytes_FromStringAndSize((char *) buf, length);
+        return bytes;
     }
 
     PyObject *to_string_()
@@ -676,7 +745,7 @@ template<> class JArray<jbyte> : public java::lang::Object {
         if (this$ == NULL)
             Py_RETURN_NONE;
 
-        arrayElements elts = elements();
+        arrayRegion elts((jbyteArray) this$, 0, length);
         jbyte *buf = (jbyte *) elts;
 
 #if PY_MAJOR_VERSION < 3
@@ -719,7 +788,10 @@ template<> class JArray<jbyte> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jbyte) PyInt_AS_LONG(obj);
+                jbyte value = (jbyte) PyInt_AS_LONG(obj);
+
+                env->get_vm_env()->SetByteArrayRegion((jbyteArray) this$,
+                                                      (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -732,13 +804,10 @@ template<> class JArray<jbyte> : public java::lang::Object {
 #endif
 
     jbyte operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jbyte *elts = (jbyte *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jbyte value = elts[n];
+        jbyte value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetByteArrayRegion((jbyteArray) this$,
+                                              (jsize) n, 1, &value);
 
         return value;
     }
@@ -770,6 +839,23 @@ template<> class JArray<jchar> : public java::lang::Object {
         return arrayElements((jcharArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jchar *elts;
+    public:
+        arrayRegion(jcharArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jchar[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetCharArrayRegion(array, (jsize) lo,
+                                                  (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jchar *() {
+            return elts;
+        }
+    };
+
     JArray<jchar>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -785,59 +871,64 @@ template<> class JArray<jchar> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jchar>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewCharArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jchar *buf = (jchar *) elts;
+
+        if (fromPyBuffer<jchar>((jarray) this$, length, sequence))
+            return;
 
         if (PyUnicode_Check(sequence))
         {
-            if (sizeof(Py_UNICODE) == sizeof(jchar))
-                memcpy(buf, PyUnicode_AS_UNICODE(sequence),
-                       length * sizeof(jchar));
-            else
-            {
-                Py_UNICODE *pchars = PyUnicode_AS_UNICODE(sequence);
-                for (Py_ssize_t i = 0; i < length; i++)
-                    buf[i] = (jchar) pchars[i];
-            }
+            arrayElements elts = elements();
+            jchar *buf = (jchar *) elts;
+
+            for (Py_ssize_t i = 0; i < length; i++)
+                buf[i] = (jchar) PyUnicode_READ_CHAR(sequence, i);
         }
         else
-            for (Py_ssize_t i = 0; i < length; i++) {
-                PyObject *obj = PySequence_GetItem(sequence, i);
+        {
+            PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-                if (!obj)
-                    break;
+            if (fast != NULL)
+            {
+                Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+                Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
 
-                if (PyUnicode_Check(obj) && (PyUnicode_GET_SIZE(obj) == 1))
-                {
-                    buf[i] = (jchar) PyUnicode_AS_UNICODE(obj)[0];
-                    Py_DECREF(obj);
-                }
-                else
-                {
-                    PyErr_SetObject(PyExc_TypeError, obj);
-                    Py_DECREF(obj);
-                    break;
-                }
+                setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+                Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+                Py_DECREF(fast);
             }
+        }
     }
 
     JArray<jchar>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewCharArray(length)) {
-        arrayElements elts = elements();
-        jchar *buf = (jchar *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetCharArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jchar buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (PyUnicode_Check(obj) && (PyUnicode_GET_SIZE(obj) == 1))
-                buf[i] = (jchar) PyUnicode_AS_UNICODE(obj)[0];
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (PyUnicode_Check(obj) && (PyUnicode_GET_LENGTH(obj) == 1))
+                    buf[i] = (jchar) PyUnicode_READ_CHAR(obj, 0);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetCharArrayRegion((jcharArray) this$,
+                                                  (jsize) lo, (jsize) count,
+                                                  buf);
         }
     }
 
@@ -859,11 +950,15 @@ template<> class JArray<jchar> : public java::lang::Object {
         else if (hi > length) hi = length;
         if (lo > hi) lo = hi;
 
-        arrayElements elts = elements();
+        arrayRegion elts((jcharArray) this$, lo, hi);
         jchar *buf = (jchar *) elts;
 
+#if PY_VERSION_HEX >= 0x03030000
+        return PyUnicode_FromKindAndData(PyUnicode_2BYTE_KIND,
+                                         buf, hi - lo);
+#else
         if (sizeof(Py_UNICODE) == sizeof(jchar))
-            return PyUnicode_FromUnicode((const Py_UNICODE *) buf + lo,
+            return PyUnicode_FromUnicode((const Py_UNICODE *) buf,
                                          hi - lo);
         else
         {
@@ -871,10 +966,11 @@ template<> class JArray<jchar> : public java::lang::Object {
             Py_UNICODE *pchars = PyUnicode_AS_UNICODE(string);
 
             for (Py_ssize_t i = lo; i < hi; i++)
-                pchars[i - lo] = (Py_UNICODE) buf[i];
+                pchars[i - lo] = (Py_UNICODE) buf[i - lo];
 
             return string;
         }
+#endif
     }
 
     PyObject *get(Py_ssize_t n)
@@ -888,17 +984,7 @@ template<> class JArray<jchar> : public java::lang::Object {
             {
                 jchar c = (*this)[n];
 
-                if (sizeof(Py_UNICODE) == sizeof(jchar))
-                    return PyUnicode_FromUnicode((const Py_UNICODE *) &c, 1);
-                else
-                {
-                    PyObject *string = PyUnicode_FromUnicode(NULL, 1);
-                    Py_UNICODE *pchars = PyUnicode_AS_UNICODE(string);
-
-                    pchars[0] = (Py_UNICODE) c;
-
-                    return string;
-                }
+                return PyUnicode_FromOrdinal((int) c);
             }
         }
 
@@ -920,13 +1006,16 @@ template<> class JArray<jchar> : public java::lang::Object {
                     PyErr_SetObject(PyExc_TypeError, obj);
                     return -1;
                 }
-                if (PyUnicode_GET_SIZE(obj) != 1)
+                if (PyUnicode_GET_LENGTH(obj) != 1)
                 {
                     PyErr_SetObject(PyExc_ValueError, obj);
                     return -1;
                 }
 
-                elements()[n] = (jchar) PyUnicode_AS_UNICODE(obj)[0];
+                jchar value = (jchar) PyUnicode_READ_CHAR(obj, 0);
+
+                env->get_vm_env()->SetCharArrayRegion((jcharArray) this$,
+                                                      (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -939,13 +1028,10 @@ template<> class JArray<jchar> : public java::lang::Object {
 #endif
 
     jchar operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jchar *elts = (jchar *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jchar value = elts[n];
+        jchar value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetCharArrayRegion((jcharArray) this$,
+                                              (jsize) n, 1, &value);
 
         return value;
     }
@@ -977,6 +1063,23 @@ template<> class JArray<jdouble> : public java::lang::Object {
         return arrayElements((jdoubleArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jdouble *elts;
+    public:
+        arrayRegion(jdoubleArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jdouble[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetDoubleArrayRegion(array, (jsize) lo,
+                                                    (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jdouble *() {
+            return elts;
+        }
+    };
+
     JArray<jdouble>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -992,46 +1095,53 @@ template<> class JArray<jdouble> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jdouble>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewDoubleArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jdouble *buf = (jdouble *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jdouble>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (PyFloat_Check(obj))
-            {
-                buf[i] = (jdouble) PyFloat_AS_DOUBLE(obj);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jdouble>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewDoubleArray(length)) {
-        arrayElements elts = elements();
-        jdouble *buf = (jdouble *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetDoubleArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jdouble buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (PyFloat_Check(obj))
-                buf[i] = (jdouble) PyFloat_AS_DOUBLE(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (PyFloat_Check(obj))
+                    buf[i] = (jdouble) PyFloat_AS_DOUBLE(obj);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetDoubleArrayRegion((jdoubleArray) this$,
+                                                    (jsize) lo, (jsize) count,
+                                                    buf);
         }
     }
 
@@ -1054,11 +1164,11 @@ template<> class JArray<jdouble> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jdoubleArray) this$, lo, hi);
         jdouble *buf = (jdouble *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++)
-            PyList_SET_ITEM(list, i - lo, PyFloat_FromDouble((double) buf[i]));
+            PyList_SET_ITEM(list, i - lo, PyFloat_FromDouble((double) buf[i - lo]));
 
         return list;
     }
@@ -1093,7 +1203,10 @@ template<> class JArray<jdouble> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jdouble) PyFloat_AS_DOUBLE(obj);
+                jdouble value = (jdouble) PyFloat_AS_DOUBLE(obj);
+
+                env->get_vm_env()->SetDoubleArrayRegion((jdoubleArray) this$,
+                                                        (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -1106,13 +1219,10 @@ template<> class JArray<jdouble> : public java::lang::Object {
 #endif
 
     jdouble operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jdouble *elts = (jdouble *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jdouble value = elts[n];
+        jdouble value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetDoubleArrayRegion((jdoubleArray) this$,
+                                                (jsize) n, 1, &value);
 
         return value;
     }
@@ -1144,6 +1254,23 @@ template<> class JArray<jfloat> : public java::lang::Object {
         return arrayElements((jfloatArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jfloat *elts;
+    public:
+        arrayRegion(jfloatArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jfloat[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetFloatArrayRegion(array, (jsize) lo,
+                                                   (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jfloat *() {
+            return elts;
+        }
+    };
+
     JArray<jfloat>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -1159,46 +1286,53 @@ template<> class JArray<jfloat> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jfloat>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewFloatArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jfloat *buf = (jfloat *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jfloat>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (PyFloat_Check(obj))
-            {
-                buf[i] = (jfloat) PyFloat_AS_DOUBLE(obj);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jfloat>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewFloatArray(length)) {
-        arrayElements elts = elements();
-        jfloat *buf = (jfloat *) elts;
+        setItems(args, length);
+    }
+
+    /* converts items in chunks, each written with one SetFloatArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jfloat buf[JARRAY_CHUNK];
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (!obj)
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
 
-            if (PyFloat_Check(obj))
-                buf[i] = (jfloat) PyFloat_AS_DOUBLE(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+                if (!obj)
+                    return;
+
+                if (PyFloat_Check(obj))
+                    buf[i] = (jfloat) PyFloat_AS_DOUBLE(obj);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetFloatArrayRegion((jfloatArray) this$,
+                                                   (jsize) lo, (jsize) count,
+                                                   buf);
         }
     }
 
@@ -1221,11 +1355,11 @@ template<> class JArray<jfloat> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jfloatArray) this$, lo, hi);
         jfloat *buf = (jfloat *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++)
-            PyList_SET_ITEM(list, i - lo, PyFloat_FromDouble((double) buf[i]));
+            PyList_SET_ITEM(list, i - lo, PyFloat_FromDouble((double) buf[i - lo]));
 
         return list;
     }
@@ -1260,7 +1394,10 @@ template<> class JArray<jfloat> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jfloat) PyFloat_AS_DOUBLE(obj);
+                jfloat value = (jfloat) PyFloat_AS_DOUBLE(obj);
+
+                env->get_vm_env()->SetFloatArrayRegion((jfloatArray) this$,
+                                                       (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -1273,13 +1410,10 @@ template<> class JArray<jfloat> : public java::lang::Object {
 #endif
 
     jfloat operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jfloat *elts = (jfloat *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jfloat value = elts[n];
+        jfloat value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetFloatArrayRegion((jfloatArray) this$,
+                                               (jsize) n, 1, &value);
 
         return value;
     }
@@ -1311,6 +1445,23 @@ template<> class JArray<jint> : public java::lang::Object {
         return arrayElements((jintArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jint *elts;
+    public:
+        arrayRegion(jintArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jint[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetIntArrayRegion(array, (jsize) lo,
+                                                 (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jint *() {
+            return elts;
+        }
+    };
+
     JArray<jint>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -1326,46 +1477,53 @@ template<> class JArray<jint> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jint>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewIntArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jint *buf = (jint *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jint>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (PyInt_Check(obj))
-            {
-                buf[i] = (jint) PyInt_AS_LONG(obj);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jint>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewIntArray(length)) {
-        arrayElements elts = elements();
-        jint *buf = (jint *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetIntArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jint buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (PyInt_Check(obj))
-                buf[i] = (jint) PyInt_AS_LONG(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (PyInt_Check(obj))
+                    buf[i] = (jint) jarray_long(obj);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetIntArrayRegion((jintArray) this$,
+                                                 (jsize) lo, (jsize) count,
+                                                 buf);
         }
     }
 
@@ -1388,11 +1546,11 @@ template<> class JArray<jint> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jintArray) this$, lo, hi);
         jint *buf = (jint *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++)
-            PyList_SET_ITEM(list, i - lo, PyInt_FromLong(buf[i]));
+            PyList_SET_ITEM(list, i - lo, PyInt_FromLong(buf[i - lo]));
 
         return list;
     }
@@ -1427,7 +1585,10 @@ template<> class JArray<jint> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jint) PyInt_AS_LONG(obj);
+                jint value = (jint) PyInt_AS_LONG(obj);
+
+                env->get_vm_env()->SetIntArrayRegion((jintArray) this$,
+                                                     (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -1440,13 +1601,10 @@ template<> class JArray<jint> : public java::lang::Object {
 #endif
 
     jint operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jint *elts = (jint *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jint value = elts[n];
+        jint value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetIntArrayRegion((jintArray) this$,
+                                             (jsize) n, 1, &value);
 
         return value;
     }
@@ -1478,6 +1636,23 @@ template<> class JArray<jlong> : public java::lang::Object {
         return arrayElements((jlongArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jlong *elts;
+    public:
+        arrayRegion(jlongArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jlong[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetLongArrayRegion(array, (jsize) lo,
+                                                  (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jlong *() {
+            return elts;
+        }
+    };
+
     JArray<jlong>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -1493,46 +1668,53 @@ template<> class JArray<jlong> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jlong>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewLongArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jlong *buf = (jlong *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jlong>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (PyLong_Check(obj))
-            {
-                buf[i] = (jlong) PyLong_AsLongLong(obj);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jlong>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewLongArray(length)) {
-        arrayElements elts = elements();
-        jlong *buf = (jlong *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetLongArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jlong buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (PyLong_Check(obj))
-                buf[i] = (jlong) PyLong_AsLongLong(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (PyLong_Check(obj))
+                    buf[i] = (jlong) jarray_longlong(obj);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetLongArrayRegion((jlongArray) this$,
+                                                  (jsize) lo, (jsize) count,
+                                                  buf);
         }
     }
 
@@ -1555,11 +1737,11 @@ template<> class JArray<jlong> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jlongArray) this$, lo, hi);
         jlong *buf = (jlong *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++)
-            PyList_SET_ITEM(list, i - lo, PyLong_FromLongLong((long long) buf[i]));
+            PyList_SET_ITEM(list, i - lo, PyLong_FromLongLong((long long) buf[i - lo]));
 
         return list;
     }
@@ -1594,7 +1776,10 @@ template<> class JArray<jlong> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jlong) PyLong_AsLongLong(obj);
+                jlong value = (jlong) PyLong_AsLongLong(obj);
+
+                env->get_vm_env()->SetLongArrayRegion((jlongArray) this$,
+                                                      (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -1606,14 +1791,11 @@ template<> class JArray<jlong> : public java::lang::Object {
     PyObject *wrap() const;
 #endif
 
-    jlong operator[](long n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jlong *elts = (jlong *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jlong value = elts[n];
+    jlong operator[](Py_ssize_t n) {
+        jlong value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetLongArrayRegion((jlongArray) this$,
+                                              (jsize) n, 1, &value);
 
         return value;
     }
@@ -1645,6 +1827,23 @@ template<> class JArray<jshort> : public java::lang::Object {
         return arrayElements((jshortArray) this$);
     }
 
+    class arrayRegion {
+    private:
+        jshort *elts;
+    public:
+        arrayRegion(jshortArray array, Py_ssize_t lo, Py_ssize_t hi) {
+            elts = new jshort[hi > lo ? hi - lo : 1];
+            env->get_vm_env()->GetShortArrayRegion(array, (jsize) lo,
+                                                   (jsize) (hi - lo), elts);
+        }
+        virtual ~arrayRegion() {
+            delete[] elts;
+        }
+        operator jshort *() {
+            return elts;
+        }
+    };
+
     JArray<jshort>(jobject obj) : java::lang::Object(obj) {
         length = this$ ? env->getArrayLength((jarray) this$) : 0;
     }
@@ -1660,46 +1859,53 @@ template<> class JArray<jshort> : public java::lang::Object {
 #ifdef PYTHON
     JArray<jshort>(PyObject *sequence) : java::lang::Object(env->get_vm_env()->NewShortArray(PySequence_Length(sequence))) {
         length = env->getArrayLength((jarray) this$);
-        arrayElements elts = elements();
-        jshort *buf = (jshort *) elts;
 
-        for (Py_ssize_t i = 0; i < length; i++) {
-            PyObject *obj = PySequence_GetItem(sequence, i);
+        if (fromPyBuffer<jshort>((jarray) this$, length, sequence))
+            return;
 
-            if (!obj)
-                break;
+        PyObject *fast = PySequence_Fast(sequence, "not a sequence");
 
-            if (PyInt_Check(obj))
-            {
-                buf[i] = (jshort) PyInt_AS_LONG(obj);
-                Py_DECREF(obj);
-            }
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                Py_DECREF(obj);
-                break;
-            }
+        if (fast != NULL)
+        {
+            Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+            Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+
+            setItems(PySequence_Fast_ITEMS(fast), n < length ? n : length);
+            Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
+            Py_DECREF(fast);
         }
     }
 
     JArray<jshort>(PyObject **args, int length) : java::lang::Object(env->get_vm_env()->NewShortArray(length)) {
-        arrayElements elts = elements();
-        jshort *buf = (jshort *) elts;
+        setItems(args, length);
+    }
 
-        for (int i = 0; i < length; i++) {
-            PyObject *obj = args[i];
+    /* converts items in chunks, each written with one SetShortArrayRegion */
+    void setItems(PyObject **items, Py_ssize_t n)
+    {
+        jshort buf[JARRAY_CHUNK];
 
-            if (!obj)
-                break;
+        for (Py_ssize_t lo = 0; lo < n; lo += JARRAY_CHUNK) {
+            Py_ssize_t count = n - lo < JARRAY_CHUNK ? n - lo : JARRAY_CHUNK;
 
-            if (PyInt_Check(obj))
-                buf[i] = (jshort) PyInt_AS_LONG(obj);
-            else
-            {
-                PyErr_SetObject(PyExc_TypeError, obj);
-                break;
+            for (Py_ssize_t i = 0; i < count; i++) {
+                PyObject *obj = items[lo + i];
+
+                if (!obj)
+                    return;
+
+                if (PyInt_Check(obj))
+                    buf[i] = (jshort) jarray_long(obj);
+                else
+                {
+                    PyErr_SetObject(PyExc_TypeError, obj);
+                    return;
+                }
             }
+
+            env->get_vm_env()->SetShortArrayRegion((jshortArray) this$,
+                                                   (jsize) lo, (jsize) count,
+                                                   buf);
         }
     }
 
@@ -1722,11 +1928,11 @@ template<> class JArray<jshort> : public java::lang::Object {
         if (lo > hi) lo = hi;
 
         PyObject *list = PyList_New(hi - lo);
-        arrayElements elts = elements();
+        arrayRegion elts((jshortArray) this$, lo, hi);
         jshort *buf = (jshort *) elts;
 
         for (Py_ssize_t i = lo; i < hi; i++)
-            PyList_SET_ITEM(list, i - lo, PyInt_FromLong(buf[i]));
+            PyList_SET_ITEM(list, i - lo, PyInt_FromLong(buf[i - lo]));
 
         return list;
     }
@@ -1761,7 +1967,10 @@ template<> class JArray<jshort> : public java::lang::Object {
                     return -1;
                 }
 
-                elements()[n] = (jshort) PyInt_AS_LONG(obj);
+                jshort value = (jshort) PyInt_AS_LONG(obj);
+
+                env->get_vm_env()->SetShortArrayRegion((jshortArray) this$,
+                                                       (jsize) n, 1, &value);
                 return 0;
             }
         }
@@ -1774,13 +1983,10 @@ template<> class JArray<jshort> : public java::lang::Object {
 #endif
 
     jshort operator[](Py_ssize_t n) {
-        JNIEnv *vm_env = env->get_vm_env();
-        jboolean isCopy = 0;
-        jshort *elts = (jshort *)
-            vm_env->GetPrimitiveArrayCritical((jarray) this$, &isCopy);
-        jshort value = elts[n];
+        jshort value;
 
-        vm_env->ReleasePrimitiveArrayCritical((jarray) this$, elts, 0);
+        env->get_vm_env()->GetShortArrayRegion((jshortArray) this$,
+                                               (jsize) n, 1, &value);
 
         return value;
     }
@@ -20,6 +20,12 @@
 
 #include "JCCEnv.h"
 #include <bytesobject.h>
+#ifdef PYTHON
+#include "macros.h"
+#endif
+
+/* strings up to this many chars are converted via a stack buffer */
+#define STRING_BUFFER_SIZE 256
 
 #if defined(_MSC_VER) || defined(__WIN32)
 _DLL_EXPORT DWORD VM_ENV = 0;
@@ -57,6 +63,31 @@ public:
 
 #endif
 
+#ifdef PYTHON
+
+/* A Java thread calling into Python gets a Python thread state that is
+ * kept until it is detached through JCC instead of one per call, see
+ * keepThreadState() and releaseThreadState().
+ */
+#if defined(_MSC_VER) || defined(__WIN32)
+static DWORD PY_TSTATE = TLS_OUT_OF_INDEXES;
+static DWORD DEADLINE = 0;
+#else
+static pthread_key_t PY_TSTATE;
+static pthread_key_t DEADLINE;
+#endif
+
+static inline void countThreadState(Py_ssize_t *counter)
+{
+#ifdef Py_GIL_DISABLED
+    _Py_atomic_add_ssize(counter, 1);
+#else
+    *counter += 1;
+#endif
+}
+
+#endif
+
 JCCEnv::JCCEnv(JavaVM *vm, JNIEnv *vm_env)
 {
 #if defined(_MSC_VER) || defined(__WIN32)
@@ -77,6 +108,20 @@ JCCEnv::JCCEnv(JavaVM *vm, JNIEnv *vm_env)
     }
 #endif
 
+#ifdef PYTHON
+#if defined(_MSC_VER) || defined(__WIN32)
+    PY_TSTATE = TlsAlloc();
+    DEADLINE = TlsAlloc();
+#else
+    pthread_key_create(&PY_TSTATE, NULL);
+    pthread_key_create(&DEADLINE, NULL);
+#endif
+    tstates_created = tstates_reused = tstates_released = 0;
+    calls = NULL;
+    gate = NULL;
+    strings = NULL;
+#endif
+
     if (vm)
         set_vm(vm, vm_env);
     else
@@ -104,6 +149,7 @@ void JCCEnv::set_vm(JavaVM *vm, JNIEnv *vm_env)
     _int = (jclass) vm_env->NewGlobalRef(vm_env->FindClass("java/lang/Integer"));
     _lon = (jclass) vm_env->NewGlobalRef(vm_env->FindClass("java/lang/Long"));
     _sho = (jclass) vm_env->NewGlobalRef(vm_env->FindClass("java/lang/Short"));
+    _packer = NULL;
 
     _mids = new jmethodID[max_mid];
 
@@ -133,6 +179,7 @@ void JCCEnv::set_vm(JavaVM *vm, JNIEnv *vm_env)
         vm_env->ExceptionClear();
         _mids[mid_iterator] = NULL;
         _mids[mid_iterator_next] = NULL;
+        _mids[mid_iterator_hasNext] = NULL;
     }
     else
     {
@@ -142,6 +189,9 @@ void JCCEnv::set_vm(JavaVM *vm, JNIEnv *vm_env)
         _mids[mid_iterator_next] =
             vm_env->GetMethodID(vm_env->FindClass("java/util/Iterator"),
                                 "next", "()Ljava/lang/Object;");
+        _mids[mid_iterator_hasNext] =
+            vm_env->GetMethodID(vm_env->FindClass("java/util/Iterator"),
+                                "hasNext", "()Z");
     }
 
     _mids[mid_enumeration_nextElement] =
@@ -528,7 +578,11 @@ void JCCEnv::reportException() const
 
     if (throwable)
     {
+#if defined(PYTHON) && defined(Py_GIL_DISABLED)
+        if (!_Py_atomic_load_int(&env->handlers))
+#else
         if (!env->handlers)
+#endif
             vm_env->ExceptionDescribe();
 
 #ifdef PYTHON
@@ -992,13 +1046,344 @@ char *JCCEnv::getClassName(jobject obj) const
 
 #ifdef PYTHON
 
+/* like toString() but decodes the local jstring straight into a str,
+ * returns NULL without a Python error set if toString() threw
+ */
+PyObject *JCCEnv::toPyString(jobject obj) const
+{
+    JNIEnv *vm_env = get_vm_env();
+    jstring str = (jstring)
+        vm_env->CallObjectMethod(obj, _mids[mid_obj_toString]);
+
+    if (vm_env->ExceptionCheck())
+    {
+        vm_env->ExceptionDescribe();
+        vm_env->ExceptionClear();
+
+        return NULL;
+    }
+
+    return fromJString(str, 1);
+}
+
+/* JavaStr: a String result of a --lazy-strings method, only decoded into
+ * a str once used as one, and handed back as is when passed to Java.
+ */
+
+class t_javastr {
+public:
+    PyObject_HEAD
+    jobject string;
+    PyObject *str;
+};
+
+extern PyTypeObject PY_TYPE(JavaStr);
+
+/* returns a borrowed reference to the decoded str */
+static PyObject *javastr_str(t_javastr *self)
+{
+    PyObject *str;
+
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(self);
+#endif
+    if (self->str == NULL)
+        self->str = env->fromJString((jstring) self->string, 0);
+    str = self->str;
+#ifdef Py_GIL_DISABLED
+    Py_END_CRITICAL_SECTION();
+#endif
+
+    return str;
+}
+
+/* returns a borrowed reference to obj or, if a JavaStr, to its str */
+static PyObject *javastr_arg(PyObject *obj)
+{
+    if (PyObject_TypeCheck(obj, &PY_TYPE(JavaStr)))
+        return javastr_str((t_javastr *) obj);
+
+    return obj;
+}
+
+static void t_javastr_dealloc(t_javastr *self)
+{
+    if (self->string != NULL)
+    {
+        JNIEnv *vm_env = env->get_vm_env();
+
+        if (vm_env != NULL)
+            vm_env->DeleteGlobalRef(self->string);
+    }
+    Py_XDECREF(self->str);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *t_javastr_repr(t_javastr *self)
+{
+    PyObject *str = javastr_str(self);
+
+    return str == NULL ? NULL : PyObject_Repr(str);
+}
+
+static PyObject *t_javastr_str(t_javastr *self)
+{
+    PyObject *str = javastr_str(self);
+
+    Py_XINCREF(str);
+    return str;
+}
+
+#if PY_VERSION_HEX < 0x03020000
+typedef long Py_hash_t;
+#endif
+
+static Py_hash_t t_javastr_hash(t_javastr *self)
+{
+    PyObject *str = javastr_str(self);
+
+    return str == NULL ? -1 : PyObject_Hash(str);
+}
+
+static PyObject *t_javastr_richcompare(t_javastr *self, PyObject *other,
+                                       int op)
+{
+    PyObject *str = javastr_str(self);
+
+    if (str == NULL || (other = javastr_arg(other)) == NULL)
+        return NULL;
+
+    return PyObject_RichCompare(str, other, op);
+}
+
+static PyObject *t_javastr_getattro(t_javastr *self, PyObject *name)
+{
+    PyObject *value = PyObject_GenericGetAttr((PyObject *) self, name);
+
+    if (value == NULL && PyErr_ExceptionMatches(PyExc_AttributeError))
+    {
+        PyObject *str = javastr_str(self);
+
+        PyErr_Clear();
+        if (str != NULL)
+            value = PyObject_GetAttr(str, name);
+    }
+
+    return value;
+}
+
+static PyObject *t_javastr_iter(t_javastr *self)
+{
+    PyObject *str = javastr_str(self);
+
+    return str == NULL ? NULL : PyObject_GetIter(str);
+}
+
+static Py_ssize_t t_javastr_length(t_javastr *self)
+{
+    PyObject *str = javastr_str(self);
+
+    return str == NULL ? -1 : PyObject_Length(str);
+}
+
+static PyObject *t_javastr_subscript(t_javastr *self, PyObject *key)
+{
+    PyObject *str = javastr_str(self);
+
+    return str == NULL ? NULL : PyObject_GetItem(str, key);
+}
+
+static int t_javastr_contains(t_javastr *self, PyObject *value)
+{
+    PyObject *str = javastr_str(self);
+
+    if (str == NULL || (value = javastr_arg(value)) == NULL)
+        return -1;
+
+    return PySequence_Contains(str, value);
+}
+
+static PyObject *t_javastr_add(PyObject *a, PyObject *b)
+{
+    if ((a = javastr_arg(a)) == NULL || (b = javastr_arg(b)) == NULL)
+        return NULL;
+
+    return PyNumber_Add(a, b);
+}
+
+static PyObject *t_javastr_multiply(PyObject *a, PyObject *b)
+{
+    if ((a = javastr_arg(a)) == NULL || (b = javastr_arg(b)) == NULL)
+        return NULL;
+
+    return PyNumber_Multiply(a, b);
+}
+
+static PyObject *t_javastr_remainder(PyObject *a, PyObject *b)
+{
+    if ((a = javastr_arg(a)) == NULL || (b = javastr_arg(b)) == NULL)
+        return NULL;
+
+    return PyNumber_Remainder(a, b);
+}
+
+static class t_javastr_protocols {
+public:
+    PyNumberMethods as_number;
+    PySequenceMethods as_sequence;
+    PyMappingMethods as_mapping;
+
+    t_javastr_protocols()
+    {
+        memset(&as_number, 0, sizeof(as_number));
+        memset(&as_sequence, 0, sizeof(as_sequence));
+        memset(&as_mapping, 0, sizeof(as_mapping));
+
+        as_number.nb_add = (binaryfunc) t_javastr_add;
+        as_number.nb_multiply = (binaryfunc) t_javastr_multiply;
+        as_number.nb_remainder = (binaryfunc) t_javastr_remainder;
+        as_sequence.sq_length = (lenfunc) t_javastr_length;
+        as_sequence.sq_contains = (objobjproc) t_javastr_contains;
+        as_mapping.mp_length = (lenfunc) t_javastr_length;
+        as_mapping.mp_subscript = (binaryfunc) t_javastr_subscript;
+    }
+} t_javastr_protocols;
+
+PyTypeObject PY_TYPE(JavaStr) = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "jcc.JavaStr",                       /* tp_name */
+    sizeof(t_javastr),                   /* tp_basicsize */
+    0,                                   /* tp_itemsize */
+    (destructor)t_javastr_dealloc,       /* tp_dealloc */
+    0,                                   /* tp_print */
+    0,                                   /* tp_getattr */
+    0,                                   /* tp_setattr */
+    0,                                   /* tp_compare */
+    (reprfunc)t_javastr_repr,            /* tp_repr */
+    &t_javastr_protocols.as_number,      /* tp_as_number */
+    &t_javastr_protocols.as_sequence,    /* tp_as_sequence */
+    &t_javastr_protocols.as_mapping,     /* tp_as_mapping */
+    (hashfunc)t_javastr_hash,            /* tp_hash  */
+    0,                                   /* tp_call */
+    (reprfunc)t_javastr_str,             /* tp_str */
+    (getattrofunc)t_javastr_getattro,    /* tp_getattro */
+    0,                                   /* tp_setattro */
+    0,                                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                  /* tp_flags */
+    "java.lang.String decoded on demand", /* tp_doc */
+    0,                                   /* tp_traverse */
+    0,                                   /* tp_clear */
+    (richcmpfunc)t_javastr_richcompare,  /* tp_richcompare */
+    0,                                   /* tp_weaklistoffset */
+    (getiterfunc)t_javastr_iter,         /* tp_iter */
+    0,                                   /* tp_iternext */
+    0,                                   /* tp_methods */
+    0,                                   /* tp_members */
+    0,                                   /* tp_getset */
+    0,                                   /* tp_base */
+    0,                                   /* tp_dict */
+    0,                                   /* tp_descr_get */
+    0,                                   /* tp_descr_set */
+    0,                                   /* tp_dictoffset */
+    0,                                   /* tp_init */
+    0,                                   /* tp_alloc */
+    0,                                   /* tp_new */
+};
+
+PyObject *JCCEnv::wrapJavaStr(jstring js) const
+{
+    if (!js)
+        Py_RETURN_NONE;
+
+    t_javastr *self = (t_javastr *)
+        PY_TYPE(JavaStr).tp_alloc(&PY_TYPE(JavaStr), 0);
+
+    if (self != NULL)
+    {
+        self->string = get_vm_env()->NewGlobalRef(js);
+        self->str = NULL;
+    }
+
+    return (PyObject *) self;
+}
+
+bool JCCEnv::isJavaStr(PyObject *object) const
+{
+    return PyObject_TypeCheck(object, &PY_TYPE(JavaStr));
+}
+
 jstring JCCEnv::fromPyString(PyObject *object) const
 {
     if (object == Py_None)
         return NULL;
 
+    if (Py_TYPE(object) == &PY_TYPE(JavaStr))
+        return (jstring)
+            get_vm_env()->NewLocalRef(((t_javastr *) object)->string);
+
     if (PyUnicode_Check(object))
     {
+#if PY_VERSION_HEX >= 0x03030000
+#if PY_VERSION_HEX < 0x030C0000
+        if (PyUnicode_READY(object) < 0)
+            return NULL;
+#endif
+        int kind = PyUnicode_KIND(object);
+        void *data = PyUnicode_DATA(object);
+        Py_ssize_t size = PyUnicode_GET_LENGTH(object);
+
+        if (kind == PyUnicode_2BYTE_KIND)
+            return get_vm_env()->NewString((const jchar *) data, (jsize) size);
+
+        /* ASCII is valid modified UTF-8 unless it contains a NUL */
+        if (PyUnicode_IS_ASCII(object) &&
+            strlen((const char *) data) == (size_t) size)
+            return get_vm_env()->NewStringUTF((const char *) data);
+
+        /* characters outside the BMP take a surrogate pair */
+        Py_ssize_t len = size;
+
+        if (kind == PyUnicode_4BYTE_KIND)
+            for (Py_ssize_t i = 0; i < size; i++)
+                if (PyUnicode_READ(kind, data, i) > 0xffff)
+                    len += 1;
+
+        jchar buf[STRING_BUFFER_SIZE];
+        jchar *jchars = len <= STRING_BUFFER_SIZE ? buf : new jchar[len];
+        jstring str;
+
+        if (kind == PyUnicode_1BYTE_KIND)
+        {
+            const Py_UCS1 *chars = (const Py_UCS1 *) data;
+
+            /* a plain loop the compiler vectorizes */
+            for (Py_ssize_t i = 0; i < size; i++)
+                jchars[i] = (jchar) chars[i];
+        }
+        else
+        {
+            const Py_UCS4 *chars = (const Py_UCS4 *) data;
+
+            for (Py_ssize_t i = 0, j = 0; i < size; i++) {
+                Py_UCS4 c = chars[i];
+
+                if (c > 0xffff)
+                {
+                    c -= 0x10000;
+                    jchars[j++] = (jchar) (0xd800 + (c >> 10));
+                    jchars[j++] = (jchar) (0xdc00 + (c & 0x3ff));
+                }
+                else
+                    jchars[j++] = (jchar) c;
+            }
+        }
+
+        str = get_vm_env()->NewString(jchars, (jsize) len);
+        if (jchars != buf)
+            delete[] jchars;
+
+        return str;
+#else
         if (sizeof(Py_UNICODE) == sizeof(jchar))
         {
             jchar *buf = (jchar *) PyUnicode_AS_UNICODE(object);
@@ -1021,6 +1406,7 @@ jstring JCCEnv::fromPyString(PyObject *object) const
 
             return str;
         }
+#endif
     }
     else if (PyBytes_Check(object))
         return fromUTF(PyBytes_AS_STRING(object));
@@ -1043,6 +1429,37 @@ PyObject *JCCEnv::fromJString(jstring js, int delete_local_ref) const
     JNIEnv *vm_env = get_vm_env();
     PyObject *string;
 
+#if PY_VERSION_HEX >= 0x03030000
+    {
+        jsize len = vm_env->GetStringLength(js);
+
+        /* the modified UTF-8 of a string is as long as the string only
+         * when it is all ASCII, it is then copied into the str directly
+         */
+        if (len > 0 && vm_env->GetStringUTFLength(js) == len)
+        {
+            string = PyUnicode_New(len, 127);
+            if (string)
+                vm_env->GetStringUTFRegion(js, 0, len, (char *)
+                                           PyUnicode_1BYTE_DATA(string));
+        }
+        else if (len <= STRING_BUFFER_SIZE)
+        {
+            jchar buf[STRING_BUFFER_SIZE];
+
+            vm_env->GetStringRegion(js, 0, len, buf);
+            string = PyUnicode_FromKindAndData(PyUnicode_2BYTE_KIND, buf, len);
+        }
+        else
+        {
+            jboolean isCopy;
+            const jchar *buf = vm_env->GetStringChars(js, &isCopy);
+
+            string = PyUnicode_FromKindAndData(PyUnicode_2BYTE_KIND, buf, len);
+            vm_env->ReleaseStringChars(js, buf);
+        }
+    }
+#else
     if (sizeof(Py_UNICODE) == sizeof(jchar))
     {
         jboolean isCopy;
@@ -1069,6 +1486,7 @@ PyObject *JCCEnv::fromJString(jstring js, int delete_local_ref) const
             vm_env->ReleaseStringChars(js, jchars);
         }
     }
+#endif
 
     if (delete_local_ref)
         vm_env->DeleteLocalRef((jobject) js);
@@ -1077,13 +1495,1045 @@ PyObject *JCCEnv::fromJString(jstring js, int delete_local_ref) const
 }
 
 
-/* may be called from finalizer thread which has no vm_env thread local */
-void JCCEnv::finalizeObject(JNIEnv *jenv, PyObject *obj)
+/* String[] and Iterator<String> elements are packed on the Java side by
+ * StringPacker, defined at runtime from the bytes below, into one String
+ * and an int[] of end offsets, with -1 - end stored for a null element:
+ *
+ *   static String pack(Object[] strings, int lo, int[] ends);
+ *   static String packIterator(Iterator it, int[] ends);
+ *
+ * packIterator() packs up to ends.length - 1 elements and stores their
+ * count last. Fewer than PACKED_STRINGS_MIN elements are not worth it.
+ */
+
+#define PACKED_STRINGS_MIN 8
+
+static const char string_packer_bytes[] = {
+    '\xca', '\xfe', '\xba', '\xbe',          // magic number: 0xcafebabe
+    '\x00', '\x00', '\x00', '\x32',          // version 50.0
+    '\x00', '\x28',                          // constant pool max index: 39
+    '\x01', '\x00', '\x1b',                  // 1: 27-byte string: org/apache/jcc/StringPacker
+    'o', 'r', 'g', '/', 'a', 'p', 'a', 'c', 'h', 'e',
+    '/', 'j', 'c', 'c', '/', 'S', 't', 'r', 'i', 'n',
+    'g', 'P', 'a', 'c', 'k', 'e', 'r',
+    '\x07', '\x00', '\x01',                  // 2: class name at 1
+    '\x01', '\x00', '\x10',                  // 3: 16-byte string: java/lang/Object
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'O', 'b', 'j', 'e', 'c', 't',
+    '\x07', '\x00', '\x03',                  // 4: class name at 3
+    '\x01', '\x00', '\x17',                  // 5: 23-byte string: java/lang/StringBuilder
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'S', 't', 'r', 'i', 'n', 'g', 'B', 'u', 'i', 'l',
+    'd', 'e', 'r',
+    '\x07', '\x00', '\x05',                  // 6: class name at 5
+    '\x01', '\x00', '\x10',                  // 7: 16-byte string: java/lang/String
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'S', 't', 'r', 'i', 'n', 'g',
+    '\x07', '\x00', '\x07',                  // 8: class name at 7
+    '\x01', '\x00', '\x12',                  // 9: 18-byte string: java/util/Iterator
+    'j', 'a', 'v', 'a', '/', 'u', 't', 'i', 'l', '/',
+    'I', 't', 'e', 'r', 'a', 't', 'o', 'r',
+    '\x07', '\x00', '\x09',                  // 10: class name at 9
+    '\x01', '\x00', '\x06',                  // 11: 6-byte string: <init>
+    '<', 'i', 'n', 'i', 't', '>',
+    '\x01', '\x00', '\x03',                  // 12: 3-byte string: ()V
+    '(', ')', 'V',
+    '\x0c', '\x00', '\x0b', '\x00', '\x0c',  // 13: name at 11, signature at 12
+    '\x0a', '\x00', '\x06', '\x00', '\x0d',  // 14: method for class 6 at 13
+    '\x01', '\x00', '\x06',                  // 15: 6-byte string: length
+    'l', 'e', 'n', 'g', 't', 'h',
+    '\x01', '\x00', '\x03',                  // 16: 3-byte string: ()I
+    '(', ')', 'I',
+    '\x0c', '\x00', '\x0f', '\x00', '\x10',  // 17: name at 15, signature at 16
+    '\x0a', '\x00', '\x06', '\x00', '\x11',  // 18: method for class 6 at 17
+    '\x01', '\x00', '\x06',                  // 19: 6-byte string: append
+    'a', 'p', 'p', 'e', 'n', 'd',
+    '\x01', '\x00', '\x2d',                  // 20: 45-byte string: append signature
+    '(', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a', 'n',
+    'g', '/', 'S', 't', 'r', 'i', 'n', 'g', ';', ')',
+    'L', 'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g',
+    '/', 'S', 't', 'r', 'i', 'n', 'g', 'B', 'u', 'i',
+    'l', 'd', 'e', 'r', ';',
+    '\x0c', '\x00', '\x13', '\x00', '\x14',  // 21: name at 19, signature at 20
+    '\x0a', '\x00', '\x06', '\x00', '\x15',  // 22: method for class 6 at 21
+    '\x01', '\x00', '\x08',                  // 23: 8-byte string: toString
+    't', 'o', 'S', 't', 'r', 'i', 'n', 'g',
+    '\x01', '\x00', '\x14',                  // 24: 20-byte string: ()Ljava/lang/String;
+    '(', ')', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a',
+    'n', 'g', '/', 'S', 't', 'r', 'i', 'n', 'g', ';',
+    '\x0c', '\x00', '\x17', '\x00', '\x18',  // 25: name at 23, signature at 24
+    '\x0a', '\x00', '\x06', '\x00', '\x19',  // 26: method for class 6 at 25
+    '\x01', '\x00', '\x07',                  // 27: 7-byte string: hasNext
+    'h', 'a', 's', 'N', 'e', 'x', 't',
+    '\x01', '\x00', '\x03',                  // 28: 3-byte string: ()Z
+    '(', ')', 'Z',
+    '\x0c', '\x00', '\x1b', '\x00', '\x1c',  // 29: name at 27, signature at 28
+    '\x0b', '\x00', '\x0a', '\x00', '\x1d',  // 30: interface method for class 10 at 29
+    '\x01', '\x00', '\x04',                  // 31: 4-byte string: next
+    'n', 'e', 'x', 't',
+    '\x01', '\x00', '\x14',                  // 32: 20-byte string: ()Ljava/lang/Object;
+    '(', ')', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a',
+    'n', 'g', '/', 'O', 'b', 'j', 'e', 'c', 't', ';',
+    '\x0c', '\x00', '\x1f', '\x00', '\x20',  // 33: name at 31, signature at 32
+    '\x0b', '\x00', '\x0a', '\x00', '\x21',  // 34: interface method for class 10 at 33
+    '\x01', '\x00', '\x04',                  // 35: 4-byte string: Code
+    'C', 'o', 'd', 'e',
+    '\x01', '\x00', '\x04',                  // 36: 4-byte string: pack
+    'p', 'a', 'c', 'k',
+    '\x01', '\x00', '\x2a',                  // 37: 42-byte string: pack signature
+    '(', '[', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a',
+    'n', 'g', '/', 'O', 'b', 'j', 'e', 'c', 't', ';',
+    'I', '[', 'I', ')', 'L', 'j', 'a', 'v', 'a', '/',
+    'l', 'a', 'n', 'g', '/', 'S', 't', 'r', 'i', 'n',
+    'g', ';',
+    '\x01', '\x00', '\x0c',                  // 38: 12-byte string: packIterator
+    'p', 'a', 'c', 'k', 'I', 't', 'e', 'r', 'a', 't',
+    'o', 'r',
+    '\x01', '\x00', '\x2a',                  // 39: 42-byte string: packIterator signature
+    '(', 'L', 'j', 'a', 'v', 'a', '/', 'u', 't', 'i',
+    'l', '/', 'I', 't', 'e', 'r', 'a', 't', 'o', 'r',
+    ';', '[', 'I', ')', 'L', 'j', 'a', 'v', 'a', '/',
+    'l', 'a', 'n', 'g', '/', 'S', 't', 'r', 'i', 'n',
+    'g', ';',
+    '\x00', '\x31',                          // public final super
+    '\x00', '\x02',                          // this class at 2
+    '\x00', '\x04',                          // superclass at 4
+    '\x00', '\x00',                          // 0 interfaces
+    '\x00', '\x00',                          // 0 fields
+    '\x00', '\x02',                          // 2 methods
+    '\x00', '\x09', '\x00', '\x24',          // public static, name at 36
+    '\x00', '\x25', '\x00', '\x01',          // signature at 37, 1 attribute
+    '\x00', '\x23',                          // attribute name at 35: Code
+    '\x00', '\x00', '\x00', '\x59',          // 89 bytes past 6 attribute bytes
+    '\x00', '\x04',                          // max stack: 4
+    '\x00', '\x07',                          // max locals: 7
+    '\x00', '\x00', '\x00', '\x4d',          // code length: 77
+    '\xbb', '\x00', '\x06', '\x59', '\xb7',  // code bytes
+    '\x00', '\x0e', '\x4e', '\x2c', '\xbe',
+    '\x36', '\x05', '\x03', '\x36', '\x04',
+    '\x15', '\x04', '\x15', '\x05', '\xa2',
+    '\x00', '\x35', '\x2a', '\x1b', '\x15',
+    '\x04', '\x60', '\x32', '\xc0', '\x00',
+    '\x08', '\x3a', '\x06', '\x19', '\x06',
+    '\xc7', '\x00', '\x10', '\x2c', '\x15',
+    '\x04', '\x02', '\x2d', '\xb6', '\x00',
+    '\x12', '\x64', '\x4f', '\xa7', '\x00',
+    '\x12', '\x2d', '\x19', '\x06', '\xb6',
+    '\x00', '\x16', '\x57', '\x2c', '\x15',
+    '\x04', '\x2d', '\xb6', '\x00', '\x12',
+    '\x4f', '\x84', '\x04', '\x01', '\xa7',
+    '\xff', '\xca', '\x2d', '\xb6', '\x00',
+    '\x1a', '\xb0',
+    '\x00', '\x00',                          // 0 method exceptions
+    '\x00', '\x00',                          // 0 method attributes
+    '\x00', '\x09', '\x00', '\x26',          // public static, name at 38
+    '\x00', '\x27', '\x00', '\x01',          // signature at 39, 1 attribute
+    '\x00', '\x23',                          // attribute name at 35: Code
+    '\x00', '\x00', '\x00', '\x65',          // 101 bytes past 6 attribute bytes
+    '\x00', '\x04',                          // max stack: 4
+    '\x00', '\x06',                          // max locals: 6
+    '\x00', '\x00', '\x00', '\x59',          // code length: 89
+    '\xbb', '\x00', '\x06', '\x59', '\xb7',  // code bytes
+    '\x00', '\x0e', '\x4d', '\x2b', '\xbe',
+    '\x04', '\x64', '\x36', '\x04', '\x03',
+    '\x3e', '\x1d', '\x15', '\x04', '\xa2',
+    '\x00', '\x3c', '\x2a', '\xb9', '\x00',
+    '\x1e', '\x01', '\x00', '\x99', '\x00',
+    '\x33', '\x2a', '\xb9', '\x00', '\x22',
+    '\x01', '\x00', '\xc0', '\x00', '\x08',
+    '\x3a', '\x05', '\x19', '\x05', '\xc7',
+    '\x00', '\x0f', '\x2b', '\x1d', '\x02',
+    '\x2c', '\xb6', '\x00', '\x12', '\x64',
+    '\x4f', '\xa7', '\x00', '\x11', '\x2c',
+    '\x19', '\x05', '\xb6', '\x00', '\x16',
+    '\x57', '\x2b', '\x1d', '\x2c', '\xb6',
+    '\x00', '\x12', '\x4f', '\x84', '\x03',
+    '\x01', '\xa7', '\xff', '\xc4', '\x2b',
+    '\x15', '\x04', '\x1d', '\x4f', '\x2c',
+    '\xb6', '\x00', '\x1a', '\xb0',
+    '\x00', '\x00',                          // 0 method exceptions
+    '\x00', '\x00',                          // 0 method attributes
+    '\x00', '\x00'                           // 0 attributes
+};
+
+static bool packerDefined = false;
+
+jclass JCCEnv::getStringPacker()
 {
-    PythonGIL gil;
+    if (packerDefined)
+        return _packer;
 
-    set_vm_env(jenv);
-    Py_DECREF(obj);
+    lock locked;
+
+    if (!packerDefined)
+    {
+        JNIEnv *vm_env = get_vm_env();
+        jclass cls = vm_env->FindClass("org/apache/jcc/StringPacker");
+
+        /* another module's JCCEnv may have defined it already */
+        if (cls == NULL)
+        {
+            vm_env->ExceptionClear();
+
+            jclass _ucl = vm_env->FindClass("java/net/URLClassLoader");
+            jmethodID mid =
+                vm_env->GetStaticMethodID(_ucl, "getSystemClassLoader",
+                                          "()Ljava/lang/ClassLoader;");
+            jobject classLoader = vm_env->CallStaticObjectMethod(_ucl, mid);
+
+            cls = vm_env->DefineClass("org/apache/jcc/StringPacker",
+                                      classLoader,
+                                      (const jbyte *) string_packer_bytes,
+                                      sizeof(string_packer_bytes));
+        }
+
+        if (cls != NULL)
+        {
+            _mids[mid_packer_pack] =
+                vm_env->GetStaticMethodID(cls, "pack",
+                                          "([Ljava/lang/Object;I[I)Ljava/lang/String;");
+            _mids[mid_packer_packIterator] =
+                vm_env->GetStaticMethodID(cls, "packIterator",
+                                          "(Ljava/util/Iterator;[I)Ljava/lang/String;");
+            _packer = (jclass) vm_env->NewGlobalRef(cls);
+        }
+        else
+            vm_env->ExceptionClear();  /* strings are then fetched one by one */
+
+        packerDefined = true;
+    }
+
+    return _packer;
+}
+
+static PyObject *fromJChars(const jchar *chars, jsize len)
+{
+#if PY_VERSION_HEX >= 0x03030000
+    return PyUnicode_FromKindAndData(PyUnicode_2BYTE_KIND, chars, len);
+#else
+    if (sizeof(Py_UNICODE) == sizeof(jchar))
+        return PyUnicode_FromUnicode((const Py_UNICODE *) chars, len);
+
+    PyObject *string = PyUnicode_FromUnicode(NULL, len);
+
+    if (string)
+    {
+        Py_UNICODE *pchars = PyUnicode_AS_UNICODE(string);
+
+        for (int i = 0; i < len; i++)
+            pchars[i] = (Py_UNICODE) chars[i];
+    }
+
+    return string;
+#endif
+}
+
+/* decodes count packed strings into a new list in one pass */
+static PyObject *fromPackedJStrings(JNIEnv *vm_env, jstring packed,
+                                    jintArray ends, int count)
+{
+    PyObject *list = PyList_New(count);
+
+    if (list == NULL || count == 0)
+        return list;
+
+    jint *offsets = vm_env->GetIntArrayElements(ends, NULL);
+    const jchar *chars = vm_env->GetStringChars(packed, NULL);
+    jint start = 0;
+
+    for (int i = 0; i < count; i++) {
+        jint end = offsets[i];
+        PyObject *string;
+
+        if (end < 0)
+        {
+            end = -1 - end;
+            string = Py_None;
+            Py_INCREF(string);
+        }
+        else if ((string = fromJChars(chars + start, end - start)) == NULL)
+        {
+            Py_CLEAR(list);
+            break;
+        }
+
+        PyList_SET_ITEM(list, i, string);
+        start = end;
+    }
+
+    vm_env->ReleaseStringChars(packed, chars);
+    vm_env->ReleaseIntArrayElements(ends, offsets, JNI_ABORT);
+
+    return list;
+}
+
+PyObject *JCCEnv::fromJStrings(jobjectArray array, int lo, int hi)
+{
+    int count = hi - lo;
+    jclass packer = count < PACKED_STRINGS_MIN ? NULL : getStringPacker();
+
+    if (packer == NULL)
+    {
+        PyObject *list = PyList_New(count);
+
+        for (int i = 0; list != NULL && i < count; i++) {
+            jstring str = (jstring) getObjectArrayElement(array, lo + i);
+
+            PyList_SET_ITEM(list, i, fromJString(str, 1));
+        }
+
+        return list;
+    }
+
+    JNIEnv *vm_env = get_vm_env();
+    jintArray ends = vm_env->NewIntArray(count);
+    jstring packed = NULL;
+
+    if (ends != NULL)
+        packed = (jstring)
+            vm_env->CallStaticObjectMethod(packer, _mids[mid_packer_pack],
+                                           array, (jint) lo, ends);
+    if (packed == NULL)
+    {
+        if (ends != NULL)
+            vm_env->DeleteLocalRef(ends);
+        reportException();
+    }
+
+    PyObject *list = fromPackedJStrings(vm_env, packed, ends, count);
+
+    vm_env->DeleteLocalRef(packed);
+    vm_env->DeleteLocalRef(ends);
+
+    return list;
+}
+
+/* returns a list of up to max next strings, empty once exhausted, the
+ * GIL is released while the iterator runs
+ */
+PyObject *JCCEnv::nextJStrings(jobject iterator, int max)
+{
+    JNIEnv *vm_env = get_vm_env();
+    jclass packer = getStringPacker();
+
+    if (packer == NULL)
+    {
+        PyObject *list = PyList_New(0);
+
+        while (list != NULL && PyList_GET_SIZE(list) < max) {
+            jboolean hasNext;
+            jstring str = NULL;
+
+            {
+                PythonThreadState state(1);
+
+                hasNext = vm_env->CallBooleanMethod(iterator,
+                                                    _mids[mid_iterator_hasNext]);
+                if (!vm_env->ExceptionCheck() && hasNext)
+                    str = (jstring)
+                        vm_env->CallObjectMethod(iterator,
+                                                 _mids[mid_iterator_next]);
+            }
+            if (vm_env->ExceptionCheck())
+            {
+                Py_DECREF(list);
+                reportException();
+            }
+            if (!hasNext)
+                break;
+
+            PyObject *string = fromJString(str, 1);
+
+            if (string == NULL || PyList_Append(list, string) < 0)
+                Py_CLEAR(list);
+            Py_XDECREF(string);
+        }
+
+        return list;
+    }
+
+    jintArray ends = vm_env->NewIntArray(max + 1);
+    jstring packed = NULL;
+
+    if (ends != NULL)
+    {
+        PythonThreadState state(1);
+
+        packed = (jstring)
+            vm_env->CallStaticObjectMethod(packer,
+                                           _mids[mid_packer_packIterator],
+                                           iterator, ends);
+    }
+    if (packed == NULL)
+    {
+        if (ends != NULL)
+            vm_env->DeleteLocalRef(ends);
+        reportException();
+    }
+
+    jint count;
+
+    vm_env->GetIntArrayRegion(ends, max, 1, &count);
+
+    PyObject *list = fromPackedJStrings(vm_env, packed, ends, count);
+
+    vm_env->DeleteLocalRef(packed);
+    vm_env->DeleteLocalRef(ends);
+
+    return list;
+}
+
+
+#define STRING_CACHE_WAYS 4
+#define STRING_CACHE_SIZE 1024
+
+/* A set-associative cache, each identity hash maps to a set of
+ * STRING_CACHE_WAYS entries, evicted with the CLOCK algorithm.
+ */
+stringCache::stringCache(int size)
+{
+    int sets = 1;
+
+    while (sets * STRING_CACHE_WAYS < size)
+        sets <<= 1;
+
+    this->size = sets * STRING_CACHE_WAYS;
+    entries = new cachedString[this->size];
+    hands = new unsigned char[sets];
+    mask = sets - 1;
+    hits = misses = evictions = 0;
+
+    memset(entries, 0, this->size * sizeof(cachedString));
+    memset(hands, 0, sets);
+}
+
+stringCache::~stringCache()
+{
+    JNIEnv *vm_env = env->get_vm_env();
+
+    for (int i = 0; i < size; i++) {
+        if (entries[i].str != NULL)
+        {
+            Py_DECREF(entries[i].str);
+            vm_env->DeleteWeakGlobalRef(entries[i].ref);
+        }
+    }
+
+    delete[] entries;
+    delete[] hands;
+}
+
+PyObject *stringCache::get(JNIEnv *vm_env, jstring js, jint hash)
+{
+    cachedString *set = &entries[(hash & mask) * STRING_CACHE_WAYS];
+    cachedString *entry;
+
+    for (int i = 0; i < STRING_CACHE_WAYS; i++) {
+        entry = &set[i];
+        if (entry->str != NULL && entry->hash == hash &&
+            vm_env->IsSameObject(entry->ref, js))
+        {
+            entry->used = 1;
+            hits += 1;
+
+            Py_INCREF(entry->str);
+            return entry->str;
+        }
+    }
+
+    PyObject *str = env->fromJString(js, 0);
+
+    if (str == NULL)
+        return NULL;
+
+    unsigned char &hand = hands[hash & mask];
+
+    for (;;) {
+        entry = &set[hand];
+        hand = (hand + 1) % STRING_CACHE_WAYS;
+        if (!entry->used)
+            break;
+        entry->used = 0;
+    }
+
+    if (entry->str != NULL)
+    {
+        Py_DECREF(entry->str);
+        vm_env->DeleteWeakGlobalRef(entry->ref);
+        evictions += 1;
+    }
+
+    entry->ref = vm_env->NewWeakGlobalRef(js);
+    entry->hash = hash;
+    entry->used = 1;
+    entry->str = str;
+    misses += 1;
+
+    Py_INCREF(str);
+    return str;
+}
+
+/* the cache is created on first use unless sized or disabled before */
+static bool stringsConfigured = false;
+
+/* size == 0 disables the cache until it is set again */
+void JCCEnv::setStringCache(int size)
+{
+#ifdef Py_GIL_DISABLED
+    lock locked;
+#endif
+
+    delete strings;
+    strings = size > 0 ? new stringCache(size) : NULL;
+    stringsConfigured = true;
+}
+
+PyObject *JCCEnv::fromJStringCached(jstring js)
+{
+    if (!js)
+        Py_RETURN_NONE;
+
+#ifdef Py_GIL_DISABLED
+    lock locked;
+#endif
+
+    if (!stringsConfigured)
+    {
+        strings = new stringCache(STRING_CACHE_SIZE);
+        stringsConfigured = true;
+    }
+
+    if (strings == NULL)
+        return fromJString(js, 0);
+
+    return strings->get(get_vm_env(), js, id(js));
+}
+
+PyObject *JCCEnv::getStringCacheStats()
+{
+#ifdef Py_GIL_DISABLED
+    lock locked;
+#endif
+
+    if (strings == NULL)
+        Py_RETURN_NONE;
+
+    long lookups = strings->hits + strings->misses;
+
+    return Py_BuildValue("{s:i,s:l,s:l,s:l,s:d}",
+                         "size", strings->size,
+                         "hits", strings->hits,
+                         "misses", strings->misses,
+                         "evictions", strings->evictions,
+                         "hit_rate", lookups ?
+                         (double) strings->hits / lookups : 0.0);
+}
+
+/* may be called from finalizer thread which has no vm_env thread local */
+void JCCEnv::finalizeObject(JNIEnv *jenv, PyObject *obj)
+{
+    PythonGIL gil(jenv);
+
+    Py_DECREF(obj);
+}
+
+/* Called right after PyGILState_Ensure() on a Java thread. When that
+ * call had to create a thread state, take another PyGILState_Ensure() on
+ * it so that the matching release doesn't delete it, it is then released
+ * by releaseThreadState() when the thread is detached.
+ */
+void JCCEnv::keepThreadState(PyGILState_STATE state, bool created)
+{
+    if (state != PyGILState_UNLOCKED)
+        return;
+
+    PyThreadState *tstate = PyGILState_GetThisThreadState();
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    if (PY_TSTATE == TLS_OUT_OF_INDEXES)
+        return;
+    if ((PyThreadState *) TlsGetValue(PY_TSTATE) == tstate)
+#else
+    if ((PyThreadState *) pthread_getspecific(PY_TSTATE) == tstate)
+#endif
+        countThreadState(&tstates_reused);
+    else if (created)
+    {
+        PyGILState_Ensure();
+#if defined(_MSC_VER) || defined(__WIN32)
+        TlsSetValue(PY_TSTATE, (LPVOID) tstate);
+#else
+        pthread_setspecific(PY_TSTATE, (void *) tstate);
+#endif
+        countThreadState(&tstates_created);
+    }
+}
+
+/* Called by JCC before detaching the current thread from the JVM, with or
+ * without the GIL. A thread state kept by keepThreadState() is released,
+ * or deleted by the outer PyGILState_Release() when Python code running
+ * on it is doing the detaching.
+ */
+void JCCEnv::releaseThreadState()
+{
+#if defined(_MSC_VER) || defined(__WIN32)
+    if (PY_TSTATE == TLS_OUT_OF_INDEXES)
+        return;
+
+    PyThreadState *kept = (PyThreadState *) TlsGetValue(PY_TSTATE);
+#else
+    PyThreadState *kept = (PyThreadState *) pthread_getspecific(PY_TSTATE);
+#endif
+
+    if (kept == NULL)
+        return;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    TlsSetValue(PY_TSTATE, NULL);
+#else
+    pthread_setspecific(PY_TSTATE, NULL);
+#endif
+
+    if (kept == PyGILState_GetThisThreadState())
+    {
+        PyGILState_STATE state = PyGILState_Ensure();
+
+        countThreadState(&tstates_released);
+
+        /* drop the count taken by keepThreadState() */
+        PyGILState_Release(PyGILState_LOCKED);
+        PyGILState_Release(state);
+    }
+}
+
+callDeadline *JCCEnv::getDeadline() const
+{
+#if defined(_MSC_VER) || defined(__WIN32)
+    return (callDeadline *) TlsGetValue(DEADLINE);
+#else
+    return (callDeadline *) pthread_getspecific(DEADLINE);
+#endif
+}
+
+void JCCEnv::setDeadline(callDeadline *deadline) const
+{
+#if defined(_MSC_VER) || defined(__WIN32)
+    TlsSetValue(DEADLINE, (LPVOID) deadline);
+#else
+    pthread_setspecific(DEADLINE, (void *) deadline);
+#endif
+}
+
+/* whether throwable is how a Java call reacted to a deadline on this
+ * thread being interrupted
+ */
+bool JCCEnv::isDeadlineInterruption(jthrowable throwable) const
+{
+    static jclass interrupted = NULL, closedByInterrupt = NULL;
+    callDeadline *deadline = getDeadline();
+
+    while (deadline != NULL && !deadline->fired)
+        deadline = deadline->outer;
+
+    if (deadline == NULL)
+        return false;
+
+    JNIEnv *vm_env = get_vm_env();
+
+    if (closedByInterrupt == NULL)
+    {
+        lock locked;
+
+        if (closedByInterrupt == NULL)
+        {
+            jclass cls = vm_env->FindClass("java/lang/InterruptedException");
+
+            interrupted = (jclass) vm_env->NewGlobalRef(cls);
+            vm_env->DeleteLocalRef(cls);
+
+            cls = vm_env->FindClass("java/nio/channels/ClosedByInterruptException");
+            closedByInterrupt = (jclass) vm_env->NewGlobalRef(cls);
+            vm_env->DeleteLocalRef(cls);
+        }
+    }
+
+    return (vm_env->IsInstanceOf(throwable, interrupted) ||
+            vm_env->IsInstanceOf(throwable, closedByInterrupt));
+}
+
+#if defined(_MSC_VER) || defined(__WIN32)
+#define CAS_LONG(p, o, n) (InterlockedCompareExchange(p, n, o) == (o))
+#define INC_LONG(p) InterlockedIncrement(p)
+#define DEC_LONG(p) InterlockedDecrement(p)
+#define BARRIER() MemoryBarrier()
+#else
+#define CAS_LONG(p, o, n) __sync_bool_compare_and_swap(p, o, n)
+#define INC_LONG(p) __sync_add_and_fetch(p, 1)
+#define DEC_LONG(p) __sync_sub_and_fetch(p, 1)
+#define BARRIER() __sync_synchronize()
+#endif
+
+callQueue::callQueue(int size) : size(size)
+{
+    long n = 1;
+
+    while (n < size)
+        n <<= 1;
+
+    slots = new queuedCall[n];
+    for (long i = 0; i < n; i++)
+        slots[i].seq = i;
+
+    mask = n - 1;
+    head = tail = active = 0;
+    waiting = closed = 0;
+    queued = overflows = drained = 0;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    InitializeCriticalSection(&mutex);
+    InitializeConditionVariable(&ready);
+#else
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&ready, NULL);
+#endif
+}
+
+void callQueue::signal()
+{
+#if defined(_MSC_VER) || defined(__WIN32)
+    EnterCriticalSection(&mutex);
+    WakeAllConditionVariable(&ready);
+    LeaveCriticalSection(&mutex);
+#else
+    pthread_mutex_lock(&mutex);
+    pthread_cond_broadcast(&ready);
+    pthread_mutex_unlock(&mutex);
+#endif
+}
+
+bool callQueue::push(JNIEnv *jenv, jobject obj, jmethodID mid,
+                     const char *name, const char *types, const jvalue *args)
+{
+    bool pushed = false;
+
+    /* close() waits for active producers before the drainer exits */
+    INC_LONG(&active);
+
+    if (!closed)
+    {
+        long pos = tail;
+        queuedCall *slot;
+
+        for (;;) {
+            slot = &slots[pos & mask];
+
+            long seq = slot->seq;
+            long dif = (long) ((unsigned long) seq - (unsigned long) pos);
+
+            if (dif == 0)
+            {
+                if (CAS_LONG(&tail, pos, pos + 1))
+                    break;
+            }
+            else if (dif < 0)
+            {
+                slot = NULL;
+                break;
+            }
+            pos = tail;
+        }
+
+        if (slot != NULL)
+        {
+            slot->obj = jenv->NewGlobalRef(obj);
+            slot->mid = mid;
+            slot->name = name;
+            slot->types = types;
+            memcpy(slot->args, args, strlen(types) * sizeof(jvalue));
+
+            BARRIER();
+            slot->seq = pos + 1;
+
+            INC_LONG(&queued);
+            pushed = true;
+        }
+        else
+            INC_LONG(&overflows);
+    }
+
+    DEC_LONG(&active);
+
+    BARRIER();
+    if (waiting)
+        signal();
+
+    return pushed;
+}
+
+static PyObject *queuedArg(char type, const jvalue &value)
+{
+    switch (type) {
+      case 'Z':
+        return PyBool_FromLong(value.z);
+      case 'B':
+        return Py_BuildValue("i", (int) value.b);
+      case 'C':
+        return PyUnicode_FromOrdinal((int) value.c);
+      case 'S':
+        return Py_BuildValue("i", (int) value.s);
+      case 'I':
+        return Py_BuildValue("i", (int) value.i);
+      case 'J':
+        return PyLong_FromLongLong((PY_LONG_LONG) value.j);
+      case 'F':
+        return PyFloat_FromDouble((double) value.f);
+      case 'D':
+        return PyFloat_FromDouble(value.d);
+    }
+
+    PyErr_SetString(PyExc_ValueError, "invalid queued argument type");
+    return NULL;
+}
+
+/* there is no Java caller left to report to, errors are unraisable */
+static void invokeQueuedCall(JNIEnv *jenv, queuedCall &call)
+{
+    jlong ptr = jenv->CallLongMethod(call.obj, call.mid);
+    PyObject *obj = (PyObject *) (Py_intptr_t) ptr;
+
+    if (jenv->ExceptionCheck())
+        jenv->ExceptionClear();
+    else if (obj != NULL)
+    {
+        int count = (int) strlen(call.types);
+        PyObject *args = PyTuple_New(count);
+        PyObject *result = NULL;
+
+        for (int i = 0; args != NULL && i < count; i++) {
+            PyObject *arg = queuedArg(call.types[i], call.args[i]);
+
+            if (arg == NULL)
+            {
+                Py_DECREF(args);
+                args = NULL;
+            }
+            else
+                PyTuple_SET_ITEM(args, i, arg);
+        }
+
+        if (args != NULL)
+        {
+            PyObject *method = PyObject_GetAttrString(obj, call.name);
+
+            if (method != NULL)
+            {
+                result = PyObject_Call(method, args, NULL);
+                Py_DECREF(method);
+            }
+            Py_DECREF(args);
+        }
+
+        if (result == NULL)
+            PyErr_WriteUnraisable(obj);
+        else
+            Py_DECREF(result);
+    }
+
+    jenv->DeleteGlobalRef(call.obj);
+}
+
+int callQueue::drain(JNIEnv *jenv, int max)
+{
+    int count = 0;
+
+    while (count < max) {
+        queuedCall *slot = &slots[head & mask];
+        queuedCall call;
+
+        if (slot->seq != head + 1)
+            break;
+
+        BARRIER();
+        call.obj = slot->obj;
+        call.mid = slot->mid;
+        call.name = slot->name;
+        call.types = slot->types;
+        memcpy(call.args, slot->args, sizeof(call.args));
+
+        BARRIER();
+        slot->seq = head + mask + 1;
+        head += 1;
+
+        invokeQueuedCall(jenv, call);
+        count += 1;
+    }
+
+    drained += count;
+
+    return count;
+}
+
+bool callQueue::wait()
+{
+#if defined(_MSC_VER) || defined(__WIN32)
+    EnterCriticalSection(&mutex);
+#else
+    pthread_mutex_lock(&mutex);
+#endif
+
+    waiting = 1;
+    BARRIER();
+
+    while (depth() == 0 && !(closed && active == 0)) {
+#if defined(_MSC_VER) || defined(__WIN32)
+        SleepConditionVariableCS(&ready, &mutex, INFINITE);
+#else
+        pthread_cond_wait(&ready, &mutex);
+#endif
+        BARRIER();
+    }
+    waiting = 0;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    LeaveCriticalSection(&mutex);
+#else
+    pthread_mutex_unlock(&mutex);
+#endif
+
+    return depth() > 0;
+}
+
+void callQueue::close()
+{
+    closed = 1;
+    BARRIER();
+    signal();
+}
+
+void callQueue::open()
+{
+    closed = 0;
+    BARRIER();
+}
+
+/* calls published and not yet drained */
+long callQueue::depth() const
+{
+    return slots[head & mask].seq == head + 1 ? tail - head : 0;
+}
+
+#if defined(_MSC_VER) || defined(__WIN32)
+#define GATE_LOCK() EnterCriticalSection(&mutex)
+#define GATE_UNLOCK() LeaveCriticalSection(&mutex)
+#define GATE_WAIT() SleepConditionVariableCS(&changed, &mutex, INFINITE)
+#define GATE_BROADCAST() WakeAllConditionVariable(&changed)
+#define GATE_HELD() (TlsGetValue(held) != NULL)
+#define GATE_HOLD(value) TlsSetValue(held, (LPVOID) (value))
+#else
+#define GATE_LOCK() pthread_mutex_lock(&mutex)
+#define GATE_UNLOCK() pthread_mutex_unlock(&mutex)
+#define GATE_WAIT() pthread_cond_wait(&changed, &mutex)
+#define GATE_BROADCAST() pthread_cond_broadcast(&changed)
+#define GATE_HELD() (pthread_getspecific(held) != NULL)
+#define GATE_HOLD(value) pthread_setspecific(held, (void *) (value))
+#endif
+
+callGate::callGate(int limit, int fair)
+{
+    next = serving = 0;
+    nextReturn = servingReturn = 0;
+    active = waiting = peak = admitted = delayed = 0;
+    this->limit = limit;
+    this->fair = fair;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    InitializeCriticalSection(&mutex);
+    InitializeConditionVariable(&changed);
+    held = TlsAlloc();
+#else
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&changed, NULL);
+    pthread_key_create(&held, NULL);
+#endif
+}
+
+void callGate::configure(int limit, int fair)
+{
+    GATE_LOCK();
+    this->limit = limit;
+    this->fair = fair;
+    GATE_BROADCAST();
+    GATE_UNLOCK();
+}
+
+/* A thread calling back into Python from Java and from there into Java
+ * again keeps its slot, waiting for another one could deadlock.
+ */
+bool callGate::enter()
+{
+    if (GATE_HELD())
+        return false;
+
+    GATE_LOCK();
+
+    unsigned long ticket = next++;
+
+    if (ticket != serving || active >= limit)
+    {
+        waiting += 1;
+        delayed += 1;
+        if (waiting > peak)
+            peak = waiting;
+
+        while (ticket != serving || active >= limit)
+            GATE_WAIT();
+
+        waiting -= 1;
+    }
+
+    serving += 1;
+    active += 1;
+    admitted += 1;
+
+    /* let the next ticket check for a free slot */
+    GATE_BROADCAST();
+    GATE_UNLOCK();
+
+    GATE_HOLD(1);
+
+    return true;
+}
+
+void callGate::leave(PyThreadState *state)
+{
+    GATE_HOLD(0);
+
+    GATE_LOCK();
+    active -= 1;
+
+    if (!fair)
+    {
+        GATE_BROADCAST();
+        GATE_UNLOCK();
+
+        PyEval_RestoreThread(state);
+        return;
+    }
+
+    /* only one thread leaving Java at a time competes for the GIL */
+    unsigned long ticket = nextReturn++;
+
+    GATE_BROADCAST();
+    while (ticket != servingReturn)
+        GATE_WAIT();
+    GATE_UNLOCK();
+
+    PyEval_RestoreThread(state);
+
+    GATE_LOCK();
+    servingReturn += 1;
+    GATE_BROADCAST();
+    GATE_UNLOCK();
 }
 
 #endif /* PYTHON */
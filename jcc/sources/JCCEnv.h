@@ -78,10 +78,131 @@ public:
     int count;
 };
 
+#ifdef PYTHON
+
+#define MAX_QUEUED_ARGS 8
+
+/* a call to a void extension method queued by a Java thread, see --async */
+class queuedCall {
+public:
+    volatile long seq;
+    jobject obj;
+    jmethodID mid;
+    const char *name, *types;
+    jvalue args[MAX_QUEUED_ARGS];
+};
+
+/* bounded ring of queued calls, pushed to without locking by any number
+ * of Java threads and drained by a single thread holding the GIL
+ */
+class _DLL_EXPORT callQueue {
+private:
+    queuedCall *slots;
+    long mask;
+    volatile long head, tail, active;
+    volatile int waiting;
+#if defined(_MSC_VER) || defined(__WIN32)
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE ready;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+#endif
+
+    void signal();
+
+public:
+    volatile int closed;
+    volatile long queued, overflows;
+    long drained;
+    const int size;
+
+    explicit callQueue(int size);
+
+    /* false when closed or full, the caller then calls synchronously */
+    bool push(JNIEnv *jenv, jobject obj, jmethodID mid,
+              const char *name, const char *types, const jvalue *args);
+    /* called with the GIL held, returns the number of calls made */
+    int drain(JNIEnv *jenv, int max);
+    /* called without the GIL, false once closed and drained */
+    bool wait();
+    void close();
+    void open();
+    long depth() const;
+};
+
+/* optional cap on the number of threads in Java through OBJ_CALL at once,
+ * admitting waiting threads in arrival order, see env.setCallGate()
+ */
+class _DLL_EXPORT callGate {
+private:
+    unsigned long next, serving;
+    unsigned long nextReturn, servingReturn;
+#if defined(_MSC_VER) || defined(__WIN32)
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE changed;
+    DWORD held;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    pthread_key_t held;
+#endif
+
+public:
+    int limit, fair;
+    long active, waiting, peak, admitted, delayed;
+
+    explicit callGate(int limit, int fair);
+
+    void configure(int limit, int fair);
+    /* called without the GIL, false if this thread is already admitted */
+    bool enter();
+    /* restores the thread state, in leaving order if fair */
+    void leave(PyThreadState *state);
+};
+
+/* recently converted Java strings, keyed by identity, see --cache-strings */
+class cachedString {
+public:
+    jweak ref;
+    jint hash;
+    int used;
+    PyObject *str;
+};
+
+class _DLL_EXPORT stringCache {
+private:
+    cachedString *entries;
+    unsigned char *hands;
+    jint mask;
+
+public:
+    int size;
+    long hits, misses, evictions;
+
+    explicit stringCache(int size);
+    ~stringCache();
+
+    /* called with the GIL held */
+    PyObject *get(JNIEnv *vm_env, jstring js, jint hash);
+};
+
+/* a deadline set on a thread with env.deadline(), see jcc.cpp */
+class callDeadline {
+public:
+    double when;
+    jobject thread;
+    volatile int fired;
+    callDeadline *outer;
+};
+
+#endif
+
 class _DLL_EXPORT JCCEnv {
 protected:
     jclass _sys, _obj, _thr;
     jclass _boo, _byt, _cha, _dou, _flo, _int, _lon, _sho;
+    jclass _packer;
     jmethodID *_mids;
 
     enum {
@@ -93,6 +214,7 @@ protected:
         mid_obj_getClass,
         mid_iterator,
         mid_iterator_next,
+        mid_iterator_hasNext,
         mid_enumeration_nextElement,
         mid_Boolean_booleanValue,
         mid_Byte_byteValue,
@@ -110,6 +232,8 @@ protected:
         mid_Integer_init,
         mid_Long_init,
         mid_Short_init,
+        mid_packer_pack,
+        mid_packer_packIterator,
         max_mid
     };
 
@@ -117,6 +241,12 @@ public:
     JavaVM *vm;
     std::multimap<int, countedRef> refs;
     int handlers;
+#ifdef PYTHON
+    Py_ssize_t tstates_created, tstates_reused, tstates_released;
+    callQueue *calls;
+    callGate *gate;
+    stringCache *strings;
+#endif
 
     explicit JCCEnv(JavaVM *vm, JNIEnv *env);
 
@@ -286,9 +416,31 @@ public:
 #ifdef PYTHON
     jclass getPythonExceptionClass() const;
     bool restorePythonException(jthrowable throwable) const;
+    PyObject *toPyString(jobject obj) const;
+    PyObject *wrapJavaStr(jstring js) const;
+    bool isJavaStr(PyObject *object) const;
     jstring fromPyString(PyObject *object) const;
     PyObject *fromJString(jstring js, int delete_local_ref) const;
+    PyObject *fromJStringCached(jstring js);
+    void setStringCache(int size);
+    PyObject *getStringCacheStats();
+    jclass getStringPacker();
+    PyObject *fromJStrings(jobjectArray array, int lo, int hi);
+    PyObject *nextJStrings(jobject iterator, int max);
     void finalizeObject(JNIEnv *jenv, PyObject *obj);
+    void keepThreadState(PyGILState_STATE state, bool created);
+    void releaseThreadState();
+
+    callDeadline *getDeadline() const;
+    void setDeadline(callDeadline *deadline) const;
+    bool isDeadlineInterruption(jthrowable throwable) const;
+
+    inline bool queueCall(JNIEnv *jenv, jobject obj, jmethodID mid,
+                          const char *name, const char *types,
+                          const jvalue *args)
+    {
+        return calls != NULL && calls->push(jenv, obj, mid, name, types, args);
+    }
 #endif
 
     inline int isSame(jobject o1, jobject o2) const
@@ -307,10 +459,14 @@ class PythonGIL {
     {
         state = PyGILState_Ensure();
     }
+    /* used by Java threads calling into Python, see keepThreadState() */
     PythonGIL(JNIEnv *vm_env)
     {
+        bool created = PyGILState_GetThisThreadState() == NULL;
+
         state = PyGILState_Ensure();
         env->set_vm_env(vm_env);
+        env->keepThreadState(state, created);
     }
     ~PythonGIL()
     {
@@ -318,21 +474,43 @@ class PythonGIL {
     }
 };
 
+/* With a free-threaded Python, releasing the thread state no longer
+ * hands over a global lock but it still detaches this thread so that a
+ * stop-the-world pause doesn't wait for a blocked Java call.
+ * env->handlers is shared between threads running Java code and is only
+ * ever changed while holding the GIL or atomically.
+ */
 class PythonThreadState {
   private:
     PyThreadState *state;
+    callGate *gate;
     int handler;
   public:
     PythonThreadState(int handler=0)
     {
-        state = PyEval_SaveThread();
         this->handler = handler;
+#ifdef Py_GIL_DISABLED
+        _Py_atomic_add_int(&env->handlers, handler);
+#else
         env->handlers += handler;
+#endif
+        gate = handler ? env->gate : NULL;
+        state = PyEval_SaveThread();
+
+        if (gate != NULL && !gate->enter())
+            gate = NULL;
     }
     ~PythonThreadState()
     {
-        PyEval_RestoreThread(state);
+        if (gate != NULL)
+            gate->leave(state);
+        else
+            PyEval_RestoreThread(state);
+#ifdef Py_GIL_DISABLED
+        _Py_atomic_add_int(&env->handlers, -handler);
+#else
         env->handlers -= handler;
+#endif
     }
 };
 
@@ -141,17 +141,19 @@ static PyObject *t_JObject_str(t_JObject *self)
 {
     if (self->object.this$)
     {
-        char *utf = env->toString(self->object.this$);
+        PyObject *str = env->toPyString(self->object.this$);
 
-        if (utf == NULL)
-            utf = env->getClassName(self->object.this$);
+        if (str != NULL || PyErr_Occurred())
+            return str;
+
+        char *utf = env->getClassName(self->object.this$);
 
         if (utf != NULL)
         {
             PyObject *unicode =
                 PyUnicode_DecodeUTF8(utf, strlen(utf), "strict");
 
-            delete utf;
+            delete[] utf;
             return unicode;
         }
     }
@@ -161,17 +163,18 @@ static PyObject *t_JObject_str(t_JObject *self)
 
 static PyObject *t_JObject_repr(t_JObject *self)
 {
-    PyObject *name = PyObject_GetAttrString((PyObject *) Py_TYPE(self),
-                                            "__name__");
+    /* the type's __name__ is its tp_name past any module prefix */
+    const char *name = Py_TYPE(self)->tp_name;
+    const char *dot = strrchr(name, '.');
     PyObject *str = Py_TYPE(self)->tp_str((PyObject *) self);
-    PyObject *args = PyTuple_Pack(2, name, str);
-    PyObject *format = PyUnicode_FromString("<%s: %s>");
-    PyObject *repr = PyUnicode_Format(format, args);
 
-    Py_DECREF(name);
+    if (str == NULL)
+        return NULL;
+
+    PyObject *repr = PyUnicode_FromFormat("<%s: %S>", dot ? dot + 1 : name,
+                                          str);
+
     Py_DECREF(str);
-    Py_DECREF(args);
-    Py_DECREF(format);
 
     return repr;
 }
@@ -42,11 +42,13 @@ using namespace java::util;
 
 PyObject *PyExc_JavaError = PyExc_ValueError;
 PyObject *PyExc_InvalidArgsError = PyExc_ValueError;
+PyObject *PyExc_JavaTimeoutError = NULL;
 
 PyObject *_set_exception_types(PyObject *self, PyObject *args)
 {
-    if (!PyArg_ParseTuple(args, "OO",
-                          &PyExc_JavaError, &PyExc_InvalidArgsError))
+    if (!PyArg_ParseTuple(args, "OO|O",
+                          &PyExc_JavaError, &PyExc_InvalidArgsError,
+                          &PyExc_JavaTimeoutError))
         return NULL;
 
     Py_RETURN_NONE;
@@ -264,6 +266,785 @@ PyObject *makeClass(PyObject *self, PyObject *args)
     return PyErr_SetJavaError();
 }
 
+/* asyncio support for java.util.concurrent.Future wrappers: completion of
+ * a CompletionStage is reported by a native BiConsumer, FutureCallback,
+ * defined at runtime from the bytes below, which hands the result over to
+ * the asyncio loop that awaited it via call_soon_threadsafe().
+ */
+
+static const char future_callback_bytes[] = {
+    '\xca', '\xfe', '\xba', '\xbe',          // magic number: 0xcafebabe
+    '\x00', '\x00', '\x00', '\x32',          // version 50.0
+    '\x00', '\x10',                          // constant pool max index: 15
+    '\x0a', '\x00', '\x03', '\x00', '\x08',  // 1: method for class 3 at 8
+    '\x07', '\x00', '\x09',                  // 2: class name at 9
+    '\x07', '\x00', '\x0a',                  // 3: class name at 10
+    '\x07', '\x00', '\x0b',                  // 4: class name at 11
+    '\x01', '\x00', '\x06',                  // 5: 6-byte string: <init>
+    '<', 'i', 'n', 'i', 't', '>',
+    '\x01', '\x00', '\x03',                  // 6: 3-byte string: ()V
+    '(', ')', 'V',
+    '\x01', '\x00', '\x04',                  // 7: 4-byte string: Code
+    'C', 'o', 'd', 'e',
+    '\x0c', '\x00', '\x05', '\x00', '\x06',  // 8: name at 5, signature at 6
+    '\x01', '\x00', '\x1d',                  // 9: 29-byte string: org/apache/jcc/FutureCallback
+    'o', 'r', 'g', '/', 'a', 'p', 'a', 'c', 'h', 'e',
+    '/', 'j', 'c', 'c', '/', 'F', 'u', 't', 'u', 'r',
+    'e', 'C', 'a', 'l', 'l', 'b', 'a', 'c', 'k',
+    '\x01', '\x00', '\x10',                  // 10: 16-byte string: java/lang/Object
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'O', 'b', 'j', 'e', 'c', 't',
+    '\x01', '\x00', '\x1d',                  // 11: 29-byte string: java/util/function/BiConsumer
+    'j', 'a', 'v', 'a', '/', 'u', 't', 'i', 'l', '/',
+    'f', 'u', 'n', 'c', 't', 'i', 'o', 'n', '/', 'B',
+    'i', 'C', 'o', 'n', 's', 'u', 'm', 'e', 'r',
+    '\x01', '\x00', '\x06',                  // 12: 6-byte string: accept
+    'a', 'c', 'c', 'e', 'p', 't',
+    '\x01', '\x00', '\x27',                  // 13: 39-byte string: accept signature
+    '(', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a', 'n',
+    'g', '/', 'O', 'b', 'j', 'e', 'c', 't', ';', 'L',
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'O', 'b', 'j', 'e', 'c', 't', ';', ')', 'V',
+    '\x01', '\x00', '\x03',                  // 14: 3-byte string: ptr
+    'p', 't', 'r',
+    '\x01', '\x00', '\x01',                  // 15: 1-byte string: J
+    'J',
+    '\x00', '\x31',                          // public final super
+    '\x00', '\x02',                          // this class at 2
+    '\x00', '\x03',                          // superclass at 3
+    '\x00', '\x01',                          // 1 interface
+    '\x00', '\x04',                          // interface at 4
+    '\x00', '\x01',                          // 1 field
+    '\x00', '\x02', '\x00', '\x0e',          // private, name at 14
+    '\x00', '\x0f', '\x00', '\x00',          // signature at 15, 0 attributes
+    '\x00', '\x02',                          // 2 methods
+    '\x00', '\x01', '\x00', '\x05',          // public, name at 5
+    '\x00', '\x06', '\x00', '\x01',          // signature at 6, 1 attribute
+    '\x00', '\x07',                          // attribute name at 7: Code
+    '\x00', '\x00', '\x00', '\x11',          // 17 bytes past 6 attribute bytes
+    '\x00', '\x01',                          // max stack: 1
+    '\x00', '\x01',                          // max locals: 1
+    '\x00', '\x00', '\x00', '\x05',          // code length: 5
+    '\x2a', '\xb7', '\x00', '\x01', '\xb1',  // actual code bytes
+    '\x00', '\x00',                          // 0 method exceptions
+    '\x00', '\x00',                          // 0 method attributes
+    '\x01', '\x11', '\x00', '\x0c',          // public final native, name at 12
+    '\x00', '\x0d', '\x00', '\x00',          // signature at 13, 0 attributes
+    '\x00', '\x00'                           // 0 attributes
+};
+
+enum {
+    mid_FutureCallback__init_,
+    mid_FutureCallback_whenComplete,
+    max_FutureCallback_mid
+};
+
+static JObject *future_callback_class = NULL;
+static jmethodID *future_callback_mids = NULL;
+static jfieldID future_callback_ptr = NULL;
+static jclass completion_stage_class = NULL;
+
+static void JNICALL _FutureCallback_accept(JNIEnv *jenv, jobject self,
+                                           jobject value, jobject error);
+
+/* returns the class defined from bytes by the system class loader, it may
+ * have been defined already by another module built with jcc
+ */
+static jclass findOrDefineClass(const char *name, const char *bytes,
+                                jsize len)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass cls = vm_env->FindClass(name);
+
+    if (cls == NULL)
+    {
+        vm_env->ExceptionClear();
+
+        jclass _ucl = env->findClass("java/net/URLClassLoader");
+        jmethodID mid = env->getStaticMethodID(_ucl, "getSystemClassLoader",
+                                               "()Ljava/lang/ClassLoader;");
+        jobject classLoader = vm_env->CallStaticObjectMethod(_ucl, mid);
+
+        cls = vm_env->DefineClass(name, classLoader, (const jbyte *) bytes,
+                                  len);
+        if (cls == NULL)
+            env->reportException();
+    }
+
+    return cls;
+}
+
+static jclass initializeFutureCallback(bool getOnly)
+{
+    if (getOnly)
+        return (jclass) (future_callback_class == NULL
+                         ? NULL : future_callback_class->this$);
+
+    if (future_callback_class == NULL)
+    {
+        JNIEnv *vm_env = env->get_vm_env();
+        jclass cls = findOrDefineClass("org/apache/jcc/FutureCallback",
+                                       future_callback_bytes,
+                                       sizeof(future_callback_bytes));
+
+        JNINativeMethod methods[] = {
+            { (char *) "accept",
+              (char *) "(Ljava/lang/Object;Ljava/lang/Object;)V",
+              (void *) _FutureCallback_accept },
+        };
+        env->registerNatives(cls, methods, 1);
+
+        jclass stage = env->findClass("java/util/concurrent/CompletionStage");
+
+        future_callback_mids = new jmethodID[max_FutureCallback_mid];
+        future_callback_mids[mid_FutureCallback__init_] =
+            env->getMethodID(cls, "<init>", "()V");
+        future_callback_mids[mid_FutureCallback_whenComplete] =
+            env->getMethodID(stage, "whenComplete",
+                             "(Ljava/util/function/BiConsumer;)Ljava/util/concurrent/CompletionStage;");
+        future_callback_ptr = env->getFieldID(cls, "ptr", "J");
+
+        completion_stage_class = (jclass) vm_env->NewGlobalRef(stage);
+        future_callback_class = new JObject(cls);
+    }
+
+    return (jclass) future_callback_class->this$;
+}
+
+static PyObject *t_future_complete(PyObject *self, PyObject *args)
+{
+    PyObject *future, *error, *value, *done;
+
+    if (!PyArg_ParseTuple(args, "OOO", &future, &error, &value))
+        return NULL;
+
+    /* the awaiting task may have been cancelled in the meantime */
+    done = PyObject_CallMethod(future, "done", "");
+    if (done == NULL)
+        return NULL;
+
+    int isDone = PyObject_IsTrue(done);
+
+    Py_DECREF(done);
+    if (isDone)
+        Py_RETURN_NONE;
+
+    if (error != Py_None)
+        return PyObject_CallMethod(future, "set_exception", "O", error);
+
+    return PyObject_CallMethod(future, "set_result", "O", value);
+}
+
+static PyMethodDef t_future_complete_def = {
+    "_complete", (PyCFunction) t_future_complete, METH_VARARGS, NULL
+};
+
+static void JNICALL _FutureCallback_accept(JNIEnv *jenv, jobject self,
+                                           jobject value, jobject error)
+{
+    jlong ptr = jenv->GetLongField(self, future_callback_ptr);
+    PyObject *pending = (PyObject *) (Py_intptr_t) ptr;
+
+    if (pending == NULL)
+        return;
+
+    jenv->SetLongField(self, future_callback_ptr, (jlong) 0);
+
+    PythonGIL gil(jenv);
+    static PyObject *complete = PyCFunction_New(&t_future_complete_def, NULL);
+    PyObject *loop = PyTuple_GET_ITEM(pending, 0);
+    PyObject *future = PyTuple_GET_ITEM(pending, 1);
+    PyObject *obj, *result;
+
+    if (error != NULL)
+    {
+        PyObject *err = t_Throwable::wrap_Object(Throwable(error));
+
+        obj = PyObject_CallFunctionObjArgs(PyExc_JavaError, err, NULL);
+        Py_DECREF(err);
+
+        result = obj == NULL ? NULL :
+            PyObject_CallMethod(loop, "call_soon_threadsafe", "OOOO",
+                                complete, future, obj, Py_None);
+    }
+    else
+    {
+        jclass cls = env->getClass(String::initializeClass);
+
+        if (value != NULL && jenv->IsInstanceOf(value, cls))
+            obj = env->fromJString((jstring) value, 0);
+        else
+            obj = t_Object::wrap_Object(Object(value));
+
+        result = obj == NULL ? NULL :
+            PyObject_CallMethod(loop, "call_soon_threadsafe", "OOOO",
+                                complete, future, Py_None, obj);
+    }
+
+    Py_XDECREF(obj);
+    Py_DECREF(pending);
+
+    if (result == NULL)
+        throwPythonError();
+    else
+        Py_DECREF(result);
+}
+
+/* returns the loop running the awaiting coroutine, get_event_loop() would
+ * make a new one when called outside of it
+ */
+static PyObject *running_loop()
+{
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    PyObject *loop;
+
+    if (asyncio == NULL)
+        return NULL;
+
+#if PY_VERSION_HEX >= 0x03070000
+    loop = PyObject_CallMethod(asyncio, "get_running_loop", "");
+#else
+    loop = PyObject_CallMethod(asyncio, "get_event_loop", "");
+#endif
+    Py_DECREF(asyncio);
+
+    return loop;
+}
+
+/* returns a new asyncio future completed by a FutureCallback registered
+ * with the CompletionStage stage
+ */
+static PyObject *stage_future(PyObject *loop, jobject stage)
+{
+    PyObject *future = PyObject_CallMethod(loop, "create_future", "");
+
+    if (future == NULL)
+        return NULL;
+
+    PyObject *pending = PyTuple_Pack(2, loop, future);
+    jmethodID mid;
+    jobject callback, result;
+    bool registered = false;
+
+    if (pending == NULL)
+    {
+        Py_DECREF(future);
+        return NULL;
+    }
+
+    try {
+        PythonThreadState state(1);
+
+        callback = env->newObject(initializeFutureCallback,
+                                  &future_callback_mids,
+                                  mid_FutureCallback__init_);
+        env->setLongField(callback, future_callback_ptr,
+                          (jlong) (Py_intptr_t) pending);
+        mid = future_callback_mids[mid_FutureCallback_whenComplete];
+        result = env->callObjectMethod(stage, mid, callback);
+        registered = true;
+
+        env->get_vm_env()->DeleteLocalRef(result);
+        env->get_vm_env()->DeleteLocalRef(callback);
+    } catch (int e) {
+        /* once registered, pending is released by the callback */
+        if (!registered)
+            Py_DECREF(pending);
+        Py_DECREF(future);
+        switch (e) {
+          case _EXC_PYTHON:
+            return NULL;
+          case _EXC_JAVA:
+            return PyErr_SetJavaError();
+          default:
+            throw;
+        }
+    }
+
+    return future;
+}
+
+PyObject *get_future_await(PyObject *self)
+{
+    PyObject *loop = running_loop();
+    PyObject *future, *result;
+
+    if (loop == NULL)
+        return NULL;
+
+    jobject obj = ((t_JObject *) self)->object.this$;
+    jboolean isStage = 0;
+
+    try {
+        jclass cls = env->getClass(initializeFutureCallback);
+
+        if (cls != NULL)
+            isStage = env->get_vm_env()->IsInstanceOf(obj,
+                                                      completion_stage_class);
+    } catch (int e) {
+        Py_DECREF(loop);
+        switch (e) {
+          case _EXC_PYTHON:
+            return NULL;
+          case _EXC_JAVA:
+            return PyErr_SetJavaError();
+          default:
+            throw;
+        }
+    }
+
+    if (!isStage)
+    {
+        /* a plain Future has no completion hook, block in a Java thread */
+        PyObject *args = Py_BuildValue("(Os)", self,
+                                       "get:()Ljava/lang/Object;");
+
+        future = args == NULL ? NULL : offload(NULL, args);
+        Py_XDECREF(args);
+    }
+    else
+        future = stage_future(loop, obj);
+    Py_DECREF(loop);
+
+    if (future == NULL)
+        return NULL;
+
+    result = PyObject_CallMethod(future, "__await__", "");
+    Py_DECREF(future);
+
+    return result;
+}
+
+#if PY_VERSION_HEX >= 0x03050000
+PyAsyncMethods future_as_async = {
+    (unaryfunc) get_future_await,            /* am_await */
+    0,                                       /* am_aiter */
+    0,                                       /* am_anext */
+};
+#endif
+
+/* offload(): a blocking Java method call is bound into a Supplier with
+ * java.lang.invoke and run with CompletableFuture.supplyAsync() on a
+ * virtual thread executor, or a cached thread pool before Java 21.
+ * The returned asyncio future is completed by a FutureCallback.
+ */
+
+enum {
+    mid_offload_getMethods,
+    mid_offload_getName,
+    mid_offload_getParameterCount,
+    mid_offload_getParameterTypes,
+    mid_offload_getModifiers,
+    mid_offload_getTypeName,
+    mid_offload_unreflect,
+    mid_offload_asType,
+    mid_offload_genericMethodType,
+    mid_offload_insertArguments,
+    mid_offload_asInterfaceInstance,
+    mid_offload_supplyAsync,
+    max_offload_mid
+};
+
+static JObject *offload_class = NULL;
+static jmethodID *offload_mids = NULL;
+static jclass offload_handles, offload_type, offload_proxies, offload_supplier;
+static jobject offload_lookup, offload_executor;
+
+static jclass offloadGlobalClass(const char *name)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass cls = env->findClass(name);
+    jclass global = (jclass) vm_env->NewGlobalRef(cls);
+
+    vm_env->DeleteLocalRef(cls);
+
+    return global;
+}
+
+static jclass initializeOffload(bool getOnly)
+{
+    if (getOnly)
+        return (jclass) (offload_class == NULL ? NULL : offload_class->this$);
+
+    if (offload_class == NULL)
+    {
+        JNIEnv *vm_env = env->get_vm_env();
+        jclass cls = env->findClass("java/util/concurrent/CompletableFuture");
+        jclass _cls = env->findClass("java/lang/Class");
+        jclass _mth = env->findClass("java/lang/reflect/Method");
+        jclass _lkp = env->findClass("java/lang/invoke/MethodHandles$Lookup");
+        jclass _mh = env->findClass("java/lang/invoke/MethodHandle");
+        jclass _exs = env->findClass("java/util/concurrent/Executors");
+        jmethodID *mids = new jmethodID[max_offload_mid];
+
+        offload_handles = offloadGlobalClass("java/lang/invoke/MethodHandles");
+        offload_type = offloadGlobalClass("java/lang/invoke/MethodType");
+        offload_proxies =
+            offloadGlobalClass("java/lang/invoke/MethodHandleProxies");
+        offload_supplier = offloadGlobalClass("java/util/function/Supplier");
+
+        mids[mid_offload_getMethods] =
+            env->getMethodID(_cls, "getMethods",
+                             "()[Ljava/lang/reflect/Method;");
+        mids[mid_offload_getName] =
+            env->getMethodID(_mth, "getName", "()Ljava/lang/String;");
+        mids[mid_offload_getParameterCount] =
+            env->getMethodID(_mth, "getParameterCount", "()I");
+        mids[mid_offload_getParameterTypes] =
+            env->getMethodID(_mth, "getParameterTypes",
+                             "()[Ljava/lang/Class;");
+        mids[mid_offload_getModifiers] =
+            env->getMethodID(_mth, "getModifiers", "()I");
+        mids[mid_offload_getTypeName] =
+            env->getMethodID(_cls, "getName", "()Ljava/lang/String;");
+        mids[mid_offload_unreflect] =
+            env->getMethodID(_lkp, "unreflect",
+                             "(Ljava/lang/reflect/Method;)Ljava/lang/invoke/MethodHandle;");
+        mids[mid_offload_asType] =
+            env->getMethodID(_mh, "asType",
+                             "(Ljava/lang/invoke/MethodType;)Ljava/lang/invoke/MethodHandle;");
+        mids[mid_offload_genericMethodType] =
+            env->getStaticMethodID(offload_type, "genericMethodType",
+                                   "(I)Ljava/lang/invoke/MethodType;");
+        mids[mid_offload_insertArguments] =
+            env->getStaticMethodID(offload_handles, "insertArguments",
+                                   "(Ljava/lang/invoke/MethodHandle;I[Ljava/lang/Object;)Ljava/lang/invoke/MethodHandle;");
+        mids[mid_offload_asInterfaceInstance] =
+            env->getStaticMethodID(offload_proxies, "asInterfaceInstance",
+                                   "(Ljava/lang/Class;Ljava/lang/invoke/MethodHandle;)Ljava/lang/Object;");
+        mids[mid_offload_supplyAsync] =
+            env->getStaticMethodID(cls, "supplyAsync",
+                                   "(Ljava/util/function/Supplier;Ljava/util/concurrent/Executor;)Ljava/util/concurrent/CompletableFuture;");
+
+        jmethodID mid = env->getStaticMethodID(offload_handles, "publicLookup",
+                                               "()Ljava/lang/invoke/MethodHandles$Lookup;");
+        jobject lookup = vm_env->CallStaticObjectMethod(offload_handles, mid);
+
+        offload_lookup = vm_env->NewGlobalRef(lookup);
+        vm_env->DeleteLocalRef(lookup);
+
+        mid = vm_env->GetStaticMethodID(_exs, "newVirtualThreadPerTaskExecutor",
+                                        "()Ljava/util/concurrent/ExecutorService;");
+        if (mid == NULL)
+        {
+            vm_env->ExceptionClear();
+            mid = env->getStaticMethodID(_exs, "newCachedThreadPool",
+                                         "()Ljava/util/concurrent/ExecutorService;");
+        }
+
+        jobject executor = vm_env->CallStaticObjectMethod(_exs, mid);
+
+        offload_executor = vm_env->NewGlobalRef(executor);
+        vm_env->DeleteLocalRef(executor);
+
+        offload_mids = mids;
+        offload_class = new JObject(cls);
+    }
+
+    return (jclass) offload_class->this$;
+}
+
+/* returns a local ref to the public method name:signature of cls, or to
+ * the only public method called name taking count arguments
+ */
+static jobject offloadMethod(JNIEnv *vm_env, jclass cls,
+                             const char *name, const char *signature,
+                             int count)
+{
+    jobject method = NULL;
+
+    if (signature != NULL)
+    {
+        jmethodID mid = vm_env->GetMethodID(cls, name, signature);
+        jboolean isStatic = JNI_FALSE;
+
+        if (mid == NULL)
+        {
+            vm_env->ExceptionClear();
+            mid = vm_env->GetStaticMethodID(cls, name, signature);
+            isStatic = JNI_TRUE;
+        }
+
+        if (mid != NULL)
+            method = vm_env->ToReflectedMethod(cls, mid, isStatic);
+        else
+            env->reportException();
+    }
+    else
+    {
+        jobjectArray methods = (jobjectArray)
+            vm_env->CallObjectMethod(cls, offload_mids[mid_offload_getMethods]);
+        int size = vm_env->GetArrayLength(methods);
+
+        for (int i = 0; i < size; i++) {
+            jobject m = vm_env->GetObjectArrayElement(methods, i);
+            jstring mName = (jstring)
+                vm_env->CallObjectMethod(m, offload_mids[mid_offload_getName]);
+            const char *chars = vm_env->GetStringUTFChars(mName, NULL);
+            bool matches = !strcmp(chars, name) &&
+                vm_env->CallIntMethod(m, offload_mids[mid_offload_getParameterCount]) == count;
+
+            vm_env->ReleaseStringUTFChars(mName, chars);
+            vm_env->DeleteLocalRef(mName);
+
+            if (!matches)
+                vm_env->DeleteLocalRef(m);
+            else
+            {
+                if (method != NULL)
+                {
+                    PyErr_Format(PyExc_TypeError,
+                                 "%s() is overloaded, use %s:<signature>",
+                                 name, name);
+                    throw _EXC_PYTHON;
+                }
+                method = m;
+            }
+        }
+    }
+
+    if (method == NULL)
+    {
+        PyErr_Format(PyExc_AttributeError, "no public method %s()", name);
+        throw _EXC_PYTHON;
+    }
+
+    return method;
+}
+
+/* returns a local ref to arg converted for a parameter of type cls, values
+ * for primitive types are boxed as such for asType() to unbox them
+ */
+static jobject offloadArg(JNIEnv *vm_env, jclass cls, PyObject *arg)
+{
+    static const struct {
+        const char *name, *boxed;
+        char code;
+    } primitives[] = {
+        { "boolean", "java.lang.Boolean", 'Z' },
+        { "byte", "java.lang.Byte", 'B' },
+        { "char", "java.lang.Character", 'C' },
+        { "short", "java.lang.Short", 'S' },
+        { "int", "java.lang.Integer", 'I' },
+        { "long", "java.lang.Long", 'J' },
+        { "float", "java.lang.Float", 'F' },
+        { "double", "java.lang.Double", 'D' },
+    };
+    jstring jname = (jstring)
+        vm_env->CallObjectMethod(cls, offload_mids[mid_offload_getTypeName]);
+    const char *name = vm_env->GetStringUTFChars(jname, NULL);
+    char code = 0;
+
+    for (unsigned int i = 0; i < sizeof(primitives) / sizeof(primitives[0]); i++) {
+        if (!strcmp(name, primitives[i].name) ||
+            !strcmp(name, primitives[i].boxed))
+        {
+            code = primitives[i].code;
+            break;
+        }
+    }
+    vm_env->ReleaseStringUTFChars(jname, name);
+    vm_env->DeleteLocalRef(jname);
+
+    if (PyObject_TypeCheck(arg, &PY_TYPE(Object)) || arg == Py_None)
+        code = 0;
+
+    switch (code) {
+      case 'Z':
+        if (arg == Py_True || arg == Py_False)
+            return env->boxBoolean(arg == Py_True);
+        break;
+      case 'C':
+        if (PyUnicode_Check(arg) && PyUnicode_GET_LENGTH(arg) == 1)
+            return env->boxChar((jchar) PyUnicode_READ_CHAR(arg, 0));
+        break;
+      case 'B':
+      case 'S':
+      case 'I':
+      case 'J':
+        if (PyInt_Check(arg) || PyLong_Check(arg))
+        {
+            PY_LONG_LONG n = PyLong_AsLongLong(arg);
+
+            if (n == -1 && PyErr_Occurred())
+                throw _EXC_PYTHON;
+
+            switch (code) {
+              case 'B':
+                return env->boxByte((jbyte) n);
+              case 'S':
+                return env->boxShort((jshort) n);
+              case 'I':
+                return env->boxInteger((jint) n);
+              default:
+                return env->boxLong((jlong) n);
+            }
+        }
+        break;
+      case 'F':
+      case 'D':
+        if (PyFloat_Check(arg) || PyInt_Check(arg) || PyLong_Check(arg))
+        {
+            double d = PyFloat_AsDouble(arg);
+
+            if (d == -1.0 && PyErr_Occurred())
+                throw _EXC_PYTHON;
+
+            if (code == 'F')
+                return env->boxFloat((jfloat) d);
+            return env->boxDouble((jdouble) d);
+        }
+        break;
+      default:
+      {
+        java::lang::Object value((jobject) NULL);
+
+        if (boxObject(NULL, arg, &value) < 0)
+            break;
+
+        return vm_env->NewLocalRef(value.this$);
+      }
+    }
+
+    if (!PyErr_Occurred())
+        PyErr_SetObject(PyExc_TypeError, arg);
+    throw _EXC_PYTHON;
+}
+
+PyObject *offload(PyObject *self, PyObject *args)
+{
+    Py_ssize_t size = PyTuple_GET_SIZE(args);
+
+    if (size < 2 ||
+        !PyObject_TypeCheck(PyTuple_GET_ITEM(args, 0), &PY_TYPE(Object)))
+    {
+        PyErr_SetString(PyExc_TypeError,
+                        "offload() takes a Java object, a method name and its arguments");
+        return NULL;
+    }
+
+    static PyObject *class_ = PyUnicode_FromString("class_");
+    PyObject *self_ = PyTuple_GET_ITEM(args, 0);
+    jobject obj = ((t_Object *) self_)->object.this$;
+    PyObject *bytes = PyTuple_GET_ITEM(args, 1);
+
+    /* the method is looked up on the class the object is wrapped as, its
+     * runtime class may not be public
+     */
+    PyObject *clsObj = PyObject_GetAttr((PyObject *) Py_TYPE(self_), class_);
+
+    if (clsObj == NULL)
+        return NULL;
+
+    if (!PyObject_TypeCheck(clsObj, &PY_TYPE(Class)))
+    {
+        PyErr_SetObject(PyExc_TypeError, clsObj);
+        Py_DECREF(clsObj);
+        return NULL;
+    }
+
+    if (PyBytes_Check(bytes))
+        Py_INCREF(bytes);
+    else if ((bytes = PyUnicode_AsUTF8String(bytes)) == NULL)
+    {
+        Py_DECREF(clsObj);
+        return NULL;
+    }
+
+    PyObject *loop = running_loop();
+
+    if (loop == NULL)
+    {
+        Py_DECREF(clsObj);
+        Py_DECREF(bytes);
+        return NULL;
+    }
+
+    int count = (int) size - 2;
+    char *name = strdup(PyBytes_AS_STRING(bytes));
+    char *signature = strchr(name, ':');
+    JNIEnv *vm_env = env->get_vm_env();
+    jobject stage = NULL;
+
+    Py_DECREF(bytes);
+    if (signature != NULL)
+        *signature++ = '\0';
+
+    vm_env->PushLocalFrame(16);
+
+    try {
+        jclass cls = env->getClass(initializeOffload);
+        jobject method = offloadMethod(vm_env, (jclass) ((t_Object *) clsObj)->object.this$, name, signature, count);
+        int isStatic = vm_env->CallIntMethod(method, offload_mids[mid_offload_getModifiers]) & 0x0008;
+        int bound = isStatic ? count : count + 1;
+        jobjectArray array =
+            env->newObjectArray(env->getClass(java::lang::Object::initializeClass), bound);
+
+        if (!isStatic)
+            vm_env->SetObjectArrayElement(array, 0, obj);
+
+        jobjectArray types = (jobjectArray)
+            vm_env->CallObjectMethod(method, offload_mids[mid_offload_getParameterTypes]);
+
+        for (int i = 0; i < count; i++) {
+            jclass type = (jclass) vm_env->GetObjectArrayElement(types, i);
+            jobject value = offloadArg(vm_env, type, PyTuple_GET_ITEM(args, i + 2));
+
+            if (vm_env->ExceptionCheck())
+                env->reportException();
+
+            vm_env->SetObjectArrayElement(array, bound - count + i, value);
+            vm_env->DeleteLocalRef(value);
+            vm_env->DeleteLocalRef(type);
+        }
+
+        PythonThreadState state(1);
+        jobject handle, type, supplier;
+
+        handle = vm_env->CallObjectMethod(offload_lookup, offload_mids[mid_offload_unreflect], method);
+        if (handle != NULL)
+        {
+            type = vm_env->CallStaticObjectMethod(offload_type, offload_mids[mid_offload_genericMethodType], (jint) bound);
+            handle = vm_env->CallObjectMethod(handle, offload_mids[mid_offload_asType], type);
+        }
+        if (handle != NULL)
+            handle = vm_env->CallStaticObjectMethod(offload_handles, offload_mids[mid_offload_insertArguments], handle, (jint) 0, array);
+        if (handle != NULL)
+        {
+            supplier = vm_env->CallStaticObjectMethod(offload_proxies, offload_mids[mid_offload_asInterfaceInstance], offload_supplier, handle);
+            if (supplier != NULL)
+                stage = vm_env->CallStaticObjectMethod(cls, offload_mids[mid_offload_supplyAsync], supplier, offload_executor);
+        }
+
+        if (stage == NULL)
+            env->reportException();
+    } catch (int e) {
+        vm_env->PopLocalFrame(NULL);
+        free(name);
+        Py_DECREF(clsObj);
+        Py_DECREF(loop);
+        switch (e) {
+          case _EXC_PYTHON:
+            return NULL;
+          case _EXC_JAVA:
+            return PyErr_SetJavaError();
+          default:
+            throw;
+        }
+    }
+
+    stage = vm_env->PopLocalFrame(stage);
+    free(name);
+    Py_DECREF(clsObj);
+
+    PyObject *future = stage_future(loop, stage);
+
+    vm_env->DeleteLocalRef(stage);
+    Py_DECREF(loop);
+
+    return future;
+}
+
 static boxfn get_boxfn(PyTypeObject *type)
 {
     static PyObject *boxfn_ = PyUnicode_FromString("boxfn_");
@@ -538,7 +1319,7 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
                   if (last)
                   {
                       if ((PyBytes_Check(arg) && (PyBytes_Size(arg) == 1)) ||
-                          (PyUnicode_Check(arg) && (PyUnicode_GET_SIZE(arg) == 1)) ||
+                          (PyUnicode_Check(arg) && (PyUnicode_GET_LENGTH(arg) == 1)) ||
                           PyInt_CheckExact(arg))
                       {
                           varargs = true;
@@ -547,7 +1328,7 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
                   }
               }
               else if ((PyBytes_Check(arg) && (PyBytes_Size(arg) == 1)) ||
-                       (PyUnicode_Check(arg) && (PyUnicode_GET_SIZE(arg) == 1)))
+                       (PyUnicode_Check(arg) && (PyUnicode_GET_LENGTH(arg) == 1)))
                   break;
               else if (PyInt_CheckExact(arg))
                   break;
@@ -566,14 +1347,14 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
 
                   if (last)
                   {
-                      if (PyUnicode_Check(arg) && (PyUnicode_GET_SIZE(arg) == 1))
+                      if (PyUnicode_Check(arg) && (PyUnicode_GET_LENGTH(arg) == 1))
                       {
                           varargs = true;
                           break;
                       }
                   }
               }
-              else if (PyUnicode_Check(arg) && PyUnicode_GET_SIZE(arg) == 1)
+              else if (PyUnicode_Check(arg) && PyUnicode_GET_LENGTH(arg) == 1)
                   break;
               return -1;
           }
@@ -773,7 +1554,7 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
                   if (PyObject_TypeCheck(arg, PY_TYPE(JArrayString)))
                       break;
 
-                  if (PySequence_Check(arg) && 
+                  if (PySequence_Check(arg) && !env->isJavaStr(arg) &&
                       !PyBytes_Check(arg) && !PyUnicode_Check(arg))
                   {
                       if (PySequence_Length(arg) > 0)
@@ -781,7 +1562,8 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
                           PyObject *obj = PySequence_GetItem(arg, 0);
                           int ok =
                               (obj == Py_None ||
-                               PyBytes_Check(obj) || PyUnicode_Check(obj));
+                               PyBytes_Check(obj) || PyUnicode_Check(obj) ||
+                               env->isJavaStr(obj));
 
                           Py_DECREF(obj);
                           if (ok)
@@ -791,14 +1573,14 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
                           break;
                   } 
 
-                  if (last && (arg == Py_None ||
+                  if (last && (arg == Py_None || env->isJavaStr(arg) ||
                                PyBytes_Check(arg) || PyUnicode_Check(arg)))
                   {
                       varargs = true;
                       break;
                   }
               }
-              else if (arg == Py_None ||
+              else if (arg == Py_None || env->isJavaStr(arg) ||
                        PyBytes_Check(arg) || PyUnicode_Check(arg))
                   break;
 
@@ -1025,7 +1807,7 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
               else if (PyUnicode_Check(arg))
               {
                   jbyte *a = va_arg(list, jbyte *);
-                  *a = (jbyte) PyUnicode_AS_UNICODE(arg)[0];
+                  *a = (jbyte) PyUnicode_READ_CHAR(arg, 0);
               }
               else
               {
@@ -1056,7 +1838,7 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
               else
               {
                   jchar *c = va_arg(list, jchar *);
-                  *c = (jchar) PyUnicode_AS_UNICODE(arg)[0];
+                  *c = (jchar) PyUnicode_READ_CHAR(arg, 0);
               }
               break;
           }
@@ -1308,16 +2090,595 @@ int _parseArgs(PyObject **args, unsigned int count, char *types, ...)
 }
 
 
+/* Interned str objects, string literals in particular, are mapped to the
+ * Java String they were last converted to. An entry keeps a reference to
+ * its str so that its address can't be reused by another one. The cache
+ * is set-associative, evicting entries with the CLOCK algorithm.
+ */
+
+#define STRING_ARG_CACHE_WAYS 4
+
+class stringArg {
+public:
+    PyObject *key;
+    String *value;
+    int used;
+};
+
+static stringArg *string_args = NULL;
+static unsigned char *string_arg_hands = NULL;
+static Py_uintptr_t string_arg_mask = 0;
+static int string_arg_size = 1024;
+static long string_arg_hits = 0, string_arg_misses = 0;
+#ifdef Py_GIL_DISABLED
+static PyMutex string_arg_mutex;
+#endif
+
+static void clearStringArgs()
+{
+    if (string_args != NULL)
+    {
+        int size = (int) (string_arg_mask + 1) * STRING_ARG_CACHE_WAYS;
+
+        for (int i = 0; i < size; i++) {
+            if (string_args[i].key != NULL)
+            {
+                Py_DECREF(string_args[i].key);
+                delete string_args[i].value;
+            }
+        }
+
+        delete[] string_args;
+        delete[] string_arg_hands;
+        string_args = NULL;
+        string_arg_hands = NULL;
+    }
+}
+
+static String cachedStringArg(PyObject *object)
+{
+    if (string_args == NULL)
+    {
+        int sets = 1;
+
+        while (sets * STRING_ARG_CACHE_WAYS < string_arg_size)
+            sets <<= 1;
+
+        string_args = new stringArg[sets * STRING_ARG_CACHE_WAYS];
+        string_arg_hands = new unsigned char[sets];
+        string_arg_mask = (Py_uintptr_t) sets - 1;
+
+        memset(string_args, 0, sets * STRING_ARG_CACHE_WAYS * sizeof(stringArg));
+        memset(string_arg_hands, 0, sets);
+    }
+
+    Py_uintptr_t n = ((Py_uintptr_t) object >> 4) & string_arg_mask;
+    stringArg *set = &string_args[n * STRING_ARG_CACHE_WAYS];
+    stringArg *entry;
+
+    for (int i = 0; i < STRING_ARG_CACHE_WAYS; i++) {
+        entry = &set[i];
+        if (entry->key == object)
+        {
+            entry->used = 1;
+            string_arg_hits += 1;
+
+            return *entry->value;
+        }
+    }
+
+    String value(env->fromPyString(object));
+
+    if (PyErr_Occurred())
+        return value;
+
+    unsigned char &hand = string_arg_hands[n];
+
+    for (;;) {
+        entry = &set[hand];
+        hand = (hand + 1) % STRING_ARG_CACHE_WAYS;
+        if (!entry->used)
+            break;
+        entry->used = 0;
+    }
+
+    if (entry->key != NULL)
+    {
+        Py_DECREF(entry->key);
+        delete entry->value;
+    }
+
+    Py_INCREF(object);
+    entry->key = object;
+    entry->value = new String(value);
+    entry->used = 1;
+    string_arg_misses += 1;
+
+    return value;
+}
+
 String p2j(PyObject *object)
 {
+#if PY_MAJOR_VERSION >= 3
+    if (string_arg_size > 0 && PyUnicode_CheckExact(object) &&
+        PyUnicode_CHECK_INTERNED(object))
+    {
+#ifdef Py_GIL_DISABLED
+        PyMutex_Lock(&string_arg_mutex);
+        String value = cachedStringArg(object);
+        PyMutex_Unlock(&string_arg_mutex);
+
+        return value;
+#else
+        return cachedStringArg(object);
+#endif
+    }
+#endif
+
     return String(env->fromPyString(object));
 }
 
+/* size == 0 disables the cache */
+PyObject *setStringArgCache(PyObject *self, PyObject *arg)
+{
+    long size = PyInt_AsLong(arg);
+
+    if (size == -1 && PyErr_Occurred())
+        return NULL;
+
+    if (size < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "size must not be negative");
+        return NULL;
+    }
+
+#ifdef Py_GIL_DISABLED
+    PyMutex_Lock(&string_arg_mutex);
+#endif
+    clearStringArgs();
+    string_arg_size = (int) size;
+    string_arg_hits = string_arg_misses = 0;
+#ifdef Py_GIL_DISABLED
+    PyMutex_Unlock(&string_arg_mutex);
+#endif
+
+    Py_RETURN_NONE;
+}
+
+PyObject *_stringArgCache(PyObject *self)
+{
+#ifdef Py_GIL_DISABLED
+    PyMutex_Lock(&string_arg_mutex);
+#endif
+    int size = string_arg_size;
+    long hits = string_arg_hits, misses = string_arg_misses;
+#ifdef Py_GIL_DISABLED
+    PyMutex_Unlock(&string_arg_mutex);
+#endif
+    long lookups = hits + misses;
+
+    return Py_BuildValue("{s:i,s:l,s:l,s:d}",
+                         "size", size,
+                         "hits", hits,
+                         "misses", misses,
+                         "hit_rate", lookups ? (double) hits / lookups : 0.0);
+}
+
 PyObject *j2p(const String& js)
 {
     return env->fromJString((jstring) js.this$, 0);
 }
 
+/* charSequence(str) wraps a Python str into a PythonCharSequence, defined
+ * at runtime from the bytes below, instead of copying it into a String.
+ * Its native methods read the PEP 393 buffer of the str, which it keeps a
+ * reference to until finalized, without the GIL as a str is immutable.
+ * A str with chars beyond the BMP, not UTF-16 already, is still copied.
+ */
+
+#if PY_VERSION_HEX >= 0x03030000
+
+#define CHAR_SEQUENCE_BUFFER_SIZE 1024
+#define CHAR_SEQUENCE_COPY_MAX 256   /* shorter subsequences are copied */
+
+static const char char_sequence_bytes[] = {
+    '\xca', '\xfe', '\xba', '\xbe',          // magic number: 0xcafebabe
+    '\x00', '\x00', '\x00', '\x32',          // version 50.0
+    '\x00', '\x1c',                          // constant pool max index: 27
+    '\x01', '\x00', '\x21',                  // 1: 33-byte string: org/apache/jcc/PythonCharSequence
+    'o', 'r', 'g', '/', 'a', 'p', 'a', 'c', 'h', 'e',
+    '/', 'j', 'c', 'c', '/', 'P', 'y', 't', 'h', 'o',
+    'n', 'C', 'h', 'a', 'r', 'S', 'e', 'q', 'u', 'e',
+    'n', 'c', 'e',
+    '\x07', '\x00', '\x01',                  // 2: class name at 1
+    '\x01', '\x00', '\x10',                  // 3: 16-byte string: java/lang/Object
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'O', 'b', 'j', 'e', 'c', 't',
+    '\x07', '\x00', '\x03',                  // 4: class name at 3
+    '\x01', '\x00', '\x16',                  // 5: 22-byte string: java/lang/CharSequence
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/',
+    'C', 'h', 'a', 'r', 'S', 'e', 'q', 'u', 'e', 'n',
+    'c', 'e',
+    '\x07', '\x00', '\x05',                  // 6: class name at 5
+    '\x01', '\x00', '\x03',                  // 7: 3-byte string: ptr
+    'p', 't', 'r',
+    '\x01', '\x00', '\x01',                  // 8: 1-byte string: J
+    'J',
+    '\x01', '\x00', '\x05',                  // 9: 5-byte string: start
+    's', 't', 'a', 'r', 't',
+    '\x01', '\x00', '\x03',                  // 10: 3-byte string: end
+    'e', 'n', 'd',
+    '\x01', '\x00', '\x01',                  // 11: 1-byte string: I
+    'I',
+    '\x01', '\x00', '\x06',                  // 12: 6-byte string: length
+    'l', 'e', 'n', 'g', 't', 'h',
+    '\x01', '\x00', '\x03',                  // 13: 3-byte string: ()I
+    '(', ')', 'I',
+    '\x01', '\x00', '\x06',                  // 14: 6-byte string: charAt
+    'c', 'h', 'a', 'r', 'A', 't',
+    '\x01', '\x00', '\x04',                  // 15: 4-byte string: (I)C
+    '(', 'I', ')', 'C',
+    '\x01', '\x00', '\x0b',                  // 16: 11-byte string: subSequence
+    's', 'u', 'b', 'S', 'e', 'q', 'u', 'e', 'n', 'c',
+    'e',
+    '\x01', '\x00', '\x1c',                  // 17: 28-byte string: subSequence signature
+    '(', 'I', 'I', ')', 'L', 'j', 'a', 'v', 'a', '/',
+    'l', 'a', 'n', 'g', '/', 'C', 'h', 'a', 'r', 'S',
+    'e', 'q', 'u', 'e', 'n', 'c', 'e', ';',
+    '\x01', '\x00', '\x08',                  // 18: 8-byte string: toString
+    't', 'o', 'S', 't', 'r', 'i', 'n', 'g',
+    '\x01', '\x00', '\x14',                  // 19: 20-byte string: ()Ljava/lang/String;
+    '(', ')', 'L', 'j', 'a', 'v', 'a', '/', 'l', 'a',
+    'n', 'g', '/', 'S', 't', 'r', 'i', 'n', 'g', ';',
+    '\x01', '\x00', '\x08',                  // 20: 8-byte string: getChars
+    'g', 'e', 't', 'C', 'h', 'a', 'r', 's',
+    '\x01', '\x00', '\x08',                  // 21: 8-byte string: (II[CI)V
+    '(', 'I', 'I', '[', 'C', 'I', ')', 'V',
+    '\x01', '\x00', '\x08',                  // 22: 8-byte string: finalize
+    'f', 'i', 'n', 'a', 'l', 'i', 'z', 'e',
+    '\x01', '\x00', '\x03',                  // 23: 3-byte string: ()V
+    '(', ')', 'V',
+    '\x01', '\x00', '\x06',                  // 24: 6-byte string: <init>
+    '<', 'i', 'n', 'i', 't', '>',
+    '\x01', '\x00', '\x04',                  // 25: 4-byte string: Code
+    'C', 'o', 'd', 'e',
+    '\x0c', '\x00', '\x18', '\x00', '\x17',  // 26: name at 24, signature at 23
+    '\x0a', '\x00', '\x04', '\x00', '\x1a',  // 27: method for class 4 at 26
+    '\x00', '\x31',                          // public final super
+    '\x00', '\x02',                          // this class at 2
+    '\x00', '\x04',                          // superclass at 4
+    '\x00', '\x01',                          // 1 interface
+    '\x00', '\x06',                          // interface at 6
+    '\x00', '\x03',                          // 3 fields
+    '\x00', '\x02', '\x00', '\x07',          // private, name at 7
+    '\x00', '\x08', '\x00', '\x00',          // signature at 8, 0 attributes
+    '\x00', '\x02', '\x00', '\x09',          // private, name at 9
+    '\x00', '\x0b', '\x00', '\x00',          // signature at 11, 0 attributes
+    '\x00', '\x02', '\x00', '\x0a',          // private, name at 10
+    '\x00', '\x0b', '\x00', '\x00',          // signature at 11, 0 attributes
+    '\x00', '\x07',                          // 7 methods
+    '\x00', '\x01', '\x00', '\x18',          // public, name at 24
+    '\x00', '\x17', '\x00', '\x01',          // signature at 23, 1 attribute
+    '\x00', '\x19',                          // attribute name at 25: Code
+    '\x00', '\x00', '\x00', '\x11',          // 17 bytes past 6 attribute bytes
+    '\x00', '\x01',                          // max stack: 1
+    '\x00', '\x01',                          // max locals: 1
+    '\x00', '\x00', '\x00', '\x05',          // code length: 5
+    '\x2a', '\xb7', '\x00', '\x1b', '\xb1',  // aload_0, invokespecial 27, return
+    '\x00', '\x00',                          // 0 method exceptions
+    '\x00', '\x00',                          // 0 method attributes
+    '\x01', '\x11', '\x00', '\x0c',          // public final native, name at 12
+    '\x00', '\x0d', '\x00', '\x00',          // signature at 13, 0 attributes
+    '\x01', '\x11', '\x00', '\x0e',          // public final native, name at 14
+    '\x00', '\x0f', '\x00', '\x00',          // signature at 15, 0 attributes
+    '\x01', '\x11', '\x00', '\x10',          // public final native, name at 16
+    '\x00', '\x11', '\x00', '\x00',          // signature at 17, 0 attributes
+    '\x01', '\x11', '\x00', '\x12',          // public final native, name at 18
+    '\x00', '\x13', '\x00', '\x00',          // signature at 19, 0 attributes
+    '\x01', '\x11', '\x00', '\x14',          // public final native, name at 20
+    '\x00', '\x15', '\x00', '\x00',          // signature at 21, 0 attributes
+    '\x01', '\x04', '\x00', '\x16',          // protected native, name at 22
+    '\x00', '\x17', '\x00', '\x00',          // signature at 23, 0 attributes
+    '\x00', '\x00'                           // 0 attributes
+};
+
+static JObject *char_sequence_class = NULL;
+static jmethodID char_sequence_init = NULL;
+static jfieldID char_sequence_ptr = NULL;
+static jfieldID char_sequence_start = NULL;
+static jfieldID char_sequence_end = NULL;
+
+static jint JNICALL _PythonCharSequence_length(JNIEnv *jenv, jobject self);
+static jchar JNICALL _PythonCharSequence_charAt(JNIEnv *jenv, jobject self,
+                                                jint index);
+static jobject JNICALL _PythonCharSequence_subSequence(JNIEnv *jenv,
+                                                       jobject self,
+                                                       jint begin, jint end);
+static jstring JNICALL _PythonCharSequence_toString(JNIEnv *jenv,
+                                                    jobject self);
+static void JNICALL _PythonCharSequence_getChars(JNIEnv *jenv, jobject self,
+                                                 jint begin, jint end,
+                                                 jcharArray dst, jint offset);
+static void JNICALL _PythonCharSequence_finalize(JNIEnv *jenv, jobject self);
+
+static jclass initializePythonCharSequence(bool getOnly)
+{
+    if (getOnly)
+        return (jclass) (char_sequence_class == NULL
+                         ? NULL : char_sequence_class->this$);
+
+    if (char_sequence_class == NULL)
+    {
+        jclass cls = findOrDefineClass("org/apache/jcc/PythonCharSequence",
+                                       char_sequence_bytes,
+                                       sizeof(char_sequence_bytes));
+
+        JNINativeMethod methods[] = {
+            { (char *) "length", (char *) "()I",
+              (void *) _PythonCharSequence_length },
+            { (char *) "charAt", (char *) "(I)C",
+              (void *) _PythonCharSequence_charAt },
+            { (char *) "subSequence",
+              (char *) "(II)Ljava/lang/CharSequence;",
+              (void *) _PythonCharSequence_subSequence },
+            { (char *) "toString", (char *) "()Ljava/lang/String;",
+              (void *) _PythonCharSequence_toString },
+            { (char *) "getChars", (char *) "(II[CI)V",
+              (void *) _PythonCharSequence_getChars },
+            { (char *) "finalize", (char *) "()V",
+              (void *) _PythonCharSequence_finalize },
+        };
+        env->registerNatives(cls, methods, 6);
+
+        char_sequence_init = env->getMethodID(cls, "<init>", "()V");
+        char_sequence_ptr = env->getFieldID(cls, "ptr", "J");
+        char_sequence_start = env->getFieldID(cls, "start", "I");
+        char_sequence_end = env->getFieldID(cls, "end", "I");
+        char_sequence_class = new JObject(cls);
+    }
+
+    return (jclass) char_sequence_class->this$;
+}
+
+/* returns the str and the range of it that self is a view of */
+static PyObject *charSequenceText(JNIEnv *jenv, jobject self,
+                                  jint *start, jint *end)
+{
+    *start = jenv->GetIntField(self, char_sequence_start);
+    *end = jenv->GetIntField(self, char_sequence_end);
+
+    return (PyObject *) (Py_intptr_t)
+        jenv->GetLongField(self, char_sequence_ptr);
+}
+
+static bool checkCharSequenceRange(JNIEnv *jenv, jint begin, jint end,
+                                   jint length)
+{
+    if (begin < 0 || begin > end || end > length)
+    {
+        char msg[80];
+
+        snprintf(msg, sizeof(msg), "begin %d, end %d, length %d",
+                 (int) begin, (int) end, (int) length);
+        jenv->ThrowNew(jenv->FindClass("java/lang/IndexOutOfBoundsException"),
+                       msg);
+
+        return false;
+    }
+
+    return true;
+}
+
+/* widens or copies count chars of text from index from into dst */
+static void copyCharSequence(JNIEnv *jenv, PyObject *text, jint from,
+                             jint count, jcharArray dst, jint offset)
+{
+    if (PyUnicode_KIND(text) == PyUnicode_2BYTE_KIND)
+    {
+        jenv->SetCharArrayRegion(dst, offset, count, (const jchar *)
+                                 PyUnicode_2BYTE_DATA(text) + from);
+        return;
+    }
+
+    const Py_UCS1 *chars = PyUnicode_1BYTE_DATA(text) + from;
+    jchar buf[CHAR_SEQUENCE_BUFFER_SIZE];
+
+    while (count > 0 && !jenv->ExceptionCheck()) {
+        jint n = count < CHAR_SEQUENCE_BUFFER_SIZE
+            ? count : CHAR_SEQUENCE_BUFFER_SIZE;
+
+        for (jint i = 0; i < n; i++)
+            buf[i] = (jchar) chars[i];
+
+        jenv->SetCharArrayRegion(dst, offset, n, buf);
+        chars += n;
+        offset += n;
+        count -= n;
+    }
+}
+
+static jstring charSequenceString(JNIEnv *jenv, PyObject *text,
+                                  jint from, jint count)
+{
+    if (PyUnicode_KIND(text) == PyUnicode_2BYTE_KIND)
+        return jenv->NewString((const jchar *)
+                               PyUnicode_2BYTE_DATA(text) + from, count);
+
+    const Py_UCS1 *chars = PyUnicode_1BYTE_DATA(text) + from;
+    jchar *jchars = new jchar[count > 0 ? count : 1];
+
+    for (jint i = 0; i < count; i++)
+        jchars[i] = (jchar) chars[i];
+
+    jstring str = jenv->NewString(jchars, count);
+
+    delete[] jchars;
+
+    return str;
+}
+
+static jint JNICALL _PythonCharSequence_length(JNIEnv *jenv, jobject self)
+{
+    jint start, end;
+
+    charSequenceText(jenv, self, &start, &end);
+
+    return end - start;
+}
+
+static jchar JNICALL _PythonCharSequence_charAt(JNIEnv *jenv, jobject self,
+                                                jint index)
+{
+    jint start, end;
+    PyObject *text = charSequenceText(jenv, self, &start, &end);
+
+    if (!checkCharSequenceRange(jenv, index, index + 1, end - start))
+        return 0;
+
+    return (jchar) PyUnicode_READ(PyUnicode_KIND(text),
+                                  PyUnicode_DATA(text), start + index);
+}
+
+static jobject JNICALL _PythonCharSequence_subSequence(JNIEnv *jenv,
+                                                       jobject self,
+                                                       jint begin, jint end)
+{
+    jint start, stop;
+    PyObject *text = charSequenceText(jenv, self, &start, &stop);
+
+    if (!checkCharSequenceRange(jenv, begin, end, stop - start))
+        return NULL;
+
+    if (end - begin <= CHAR_SEQUENCE_COPY_MAX)
+        return charSequenceString(jenv, text, start + begin, end - begin);
+
+    /* made with <init> so that the view is finalized */
+    jobject view = jenv->NewObject((jclass) char_sequence_class->this$,
+                                   char_sequence_init);
+
+    if (view != NULL)
+    {
+        PythonGIL gil(jenv);
+
+        Py_INCREF(text);
+        jenv->SetLongField(view, char_sequence_ptr,
+                           (jlong) (Py_intptr_t) text);
+        jenv->SetIntField(view, char_sequence_start, start + begin);
+        jenv->SetIntField(view, char_sequence_end, start + end);
+    }
+
+    return view;
+}
+
+static jstring JNICALL _PythonCharSequence_toString(JNIEnv *jenv,
+                                                    jobject self)
+{
+    jint start, end;
+    PyObject *text = charSequenceText(jenv, self, &start, &end);
+
+    return charSequenceString(jenv, text, start, end - start);
+}
+
+static void JNICALL _PythonCharSequence_getChars(JNIEnv *jenv, jobject self,
+                                                 jint begin, jint end,
+                                                 jcharArray dst, jint offset)
+{
+    jint start, stop;
+    PyObject *text = charSequenceText(jenv, self, &start, &stop);
+
+    if (!checkCharSequenceRange(jenv, begin, end, stop - start))
+        return;
+
+    if (dst == NULL)
+    {
+        jenv->ThrowNew(jenv->FindClass("java/lang/NullPointerException"),
+                       "dst");
+        return;
+    }
+
+    copyCharSequence(jenv, text, start + begin, end - begin, dst, offset);
+}
+
+static void JNICALL _PythonCharSequence_finalize(JNIEnv *jenv, jobject self)
+{
+    jlong ptr = jenv->GetLongField(self, char_sequence_ptr);
+
+    if (ptr)
+    {
+        jenv->SetLongField(self, char_sequence_ptr, (jlong) 0);
+        env->finalizeObject(jenv, (PyObject *) (Py_intptr_t) ptr);
+    }
+}
+
+#endif
+
+PyObject *charSequence(PyObject *self, PyObject *arg)
+{
+    if (!PyUnicode_Check(arg) && !PyBytes_Check(arg))
+    {
+        PyErr_SetObject(PyExc_TypeError, arg);
+        return NULL;
+    }
+
+#if PY_VERSION_HEX >= 0x03030000
+    if (PyUnicode_CheckExact(arg) && PyUnicode_READY(arg) == 0 &&
+        PyUnicode_KIND(arg) != PyUnicode_4BYTE_KIND &&
+        PyUnicode_GET_LENGTH(arg) <= 0x7fffffff)
+    {
+        JNIEnv *vm_env = env->get_vm_env();
+        jobject view = NULL;
+
+        try {
+            jclass cls = env->getClass(initializePythonCharSequence);
+
+            view = vm_env->NewObject(cls, char_sequence_init);
+        } catch (int e) {
+            switch (e) {
+              case _EXC_PYTHON:
+                return NULL;
+              case _EXC_JAVA:
+                return PyErr_SetJavaError();
+              default:
+                throw;
+            }
+        }
+        if (view == NULL)
+            return PyErr_SetJavaError();
+
+        Py_INCREF(arg);
+        vm_env->SetLongField(view, char_sequence_ptr,
+                             (jlong) (Py_intptr_t) arg);
+        vm_env->SetIntField(view, char_sequence_start, 0);
+        vm_env->SetIntField(view, char_sequence_end,
+                            (jint) PyUnicode_GET_LENGTH(arg));
+
+        return t_Object::wrap_Object(Object(view));
+    }
+#endif
+
+    return t_Object::wrap_Object(p2j(arg));
+}
+
+/* iterates the Strings of an Iterable or Iterator in packed chunks, see
+ * make_string_iterator(), which fetches strings ahead of the loop
+ */
+PyObject *iterStrings(PyObject *self, PyObject *arg)
+{
+    if (!PyObject_TypeCheck(arg, &PY_TYPE(Object)))
+    {
+        PyErr_SetObject(PyExc_TypeError, arg);
+        return NULL;
+    }
+
+    jobject obj = ((t_Object *) arg)->object.this$;
+    jobject iterator;
+
+    OBJ_CALL(iterator = env->isInstanceOf(obj, java::util::Iterator::initializeClass)
+             ? obj : env->iterator(obj));
+
+    return make_string_iterator(iterator);
+}
+
 PyObject *PyErr_SetArgsError(char *name, PyObject *args)
 {
     if (!PyErr_Occurred())
@@ -1368,9 +2729,15 @@ PyObject *PyErr_SetJavaError()
     if (env->restorePythonException(throwable))
         return NULL;
 
+    PyObject *type = PyExc_JavaError;
+
+    if (PyExc_JavaTimeoutError != NULL &&
+        env->isDeadlineInterruption(throwable))
+        type = PyExc_JavaTimeoutError;
+
     PyObject *err = t_Throwable::wrap_Object(Throwable(throwable));
 
-    PyErr_SetObject(PyExc_JavaError, err);
+    PyErr_SetObject(type, err);
     Py_DECREF(err);
 
     return NULL;
@@ -1558,7 +2925,8 @@ static bool setArrayObj(jobjectArray array, int index, PyObject *obj)
 
     if (obj == Py_None)
       jobj = NULL;
-    else if (PyBytes_Check(obj) || PyUnicode_Check(obj))
+    else if (PyBytes_Check(obj) || PyUnicode_Check(obj) ||
+             env->isJavaStr(obj))
     {
         jobj = env->fromPyString(obj);
         deleteLocal = true;
@@ -1614,6 +2982,59 @@ static bool setArrayObj(jobjectArray array, int index, PyObject *obj)
 }
 
 
+/* Stores the Java objects of items into array when they all are wrappers
+ * of one type whose Java class is assignable to cls, checking the type and
+ * the class once instead of converting and checking every item. Returns 0
+ * when items aren't such wrappers, leaving them to setArrayObj().
+ */
+static int setArrayObjs(jobjectArray array, jclass cls,
+                        PyObject **items, int length)
+{
+    static PyObject *class_ = PyUnicode_FromString("class_");
+
+    if (length == 0 || items[0] == NULL)
+        return 0;
+
+    PyTypeObject *type = Py_TYPE(items[0]);
+
+    if (!PyType_IsSubtype(type, &PY_TYPE(Object)))
+        return 0;
+
+    for (int i = 1; i < length; i++)
+        if (items[i] == NULL || Py_TYPE(items[i]) != type)
+            return 0;
+
+    PyObject *clsObj = PyObject_GetAttr((PyObject *) type, class_);
+    JNIEnv *vm_env = env->get_vm_env();
+    int assignable;
+
+    if (clsObj == NULL)
+    {
+        PyErr_Clear();
+        return 0;
+    }
+
+    assignable = PyObject_TypeCheck(clsObj, &PY_TYPE(Class)) &&
+        vm_env->IsAssignableFrom(
+            (jclass) ((t_Object *) clsObj)->object.this$, cls);
+    Py_DECREF(clsObj);
+
+    if (!assignable)
+        return 0;
+
+    for (int i = 0; i < length && !vm_env->ExceptionCheck(); i++)
+        vm_env->SetObjectArrayElement(
+            array, i, ((t_Object *) items[i])->object.this$);
+
+    if (vm_env->ExceptionCheck())
+    {
+        PyErr_SetJavaError();
+        return -1;
+    }
+
+    return 1;
+}
+
 jobjectArray fromPySequence(jclass cls, PyObject *sequence)
 {
     if (sequence == Py_None)
@@ -1625,32 +3046,18 @@ jobjectArray fromPySequence(jclass cls, PyObject *sequence)
         return NULL;
     }
 
-    int length = PySequence_Length(sequence);
+    PyObject *fast = PySequence_Fast(sequence, "not a sequence");
     jobjectArray array;
 
-    try {
-        array = env->newObjectArray(cls, length);
-    } catch (int e) {
-        switch (e) {
-          case _EXC_PYTHON:
-            return NULL;
-          case _EXC_JAVA:
-            PyErr_SetJavaError();
-            return NULL;
-          default:
-            throw;
-        }
-    }
-
-    for (int i = 0; i < length; i++) {
-        PyObject *obj = PySequence_GetItem(sequence, i);
+    if (fast == NULL)
+        return NULL;
 
-        if (!obj)
-            break;
+    Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(sequence);
+    array = fromPySequence(cls, PySequence_Fast_ITEMS(fast),
+                           (int) PySequence_Fast_GET_SIZE(fast));
+    Py_END_CRITICAL_SECTION_SEQUENCE_FAST();
 
-        if (!setArrayObj(array, i, obj))
-            return NULL;
-    }
+    Py_DECREF(fast);
 
     return array;
 }
@@ -1673,6 +3080,13 @@ jobjectArray fromPySequence(jclass cls, PyObject **args, int length)
         }
     }
 
+    switch (setArrayObjs(array, cls, args, length)) {
+      case -1:
+        return NULL;
+      case 1:
+        return array;
+    }
+
     for (int i = 0; i < length; i++) {
         PyObject *obj = args[i];
 
@@ -1695,7 +3109,7 @@ void installType(PyTypeObject *type, PyObject *module, char *name,
         Py_INCREF(type);
         if (isExtension)
         {
-            Py_TYPE(type) = &PY_TYPE(FinalizerClass);
+            Py_SET_TYPE(type, &PY_TYPE(FinalizerClass));
             Py_INCREF(&PY_TYPE(FinalizerClass));
         }
         PyModule_AddObject(module, name, (PyObject *) type);
@@ -1766,7 +3180,7 @@ PyObject *unboxCharacter(const jobject &obj)
         }
         
         jchar c = env->charValue(obj);
-        return PyUnicode_FromUnicode((Py_UNICODE *) &c, 1);
+        return PyUnicode_FromOrdinal((int) c);
     }
 
     Py_RETURN_NONE;
@@ -2005,13 +3419,13 @@ int boxCharacter(PyTypeObject *type, PyObject *arg, java::lang::Object *obj)
     }
     else if (PyUnicode_Check(arg))
     {
-        Py_ssize_t len = PyUnicode_GetSize(arg);
+        Py_ssize_t len = PyUnicode_GET_LENGTH(arg);
 
         if (len != 1)
             return -1;
 
         if (obj != NULL)
-            *obj = Character((jchar) PyUnicode_AS_UNICODE(arg)[0]);
+            *obj = Character((jchar) PyUnicode_READ_CHAR(arg, 0));
     }
     else
         return -1;
@@ -2026,7 +3440,7 @@ int boxCharSequence(PyTypeObject *type, PyObject *arg, java::lang::Object *obj)
     if (result <= 0)
         return result;
 
-    if (PyBytes_Check(arg) || PyUnicode_Check(arg))
+    if (PyBytes_Check(arg) || PyUnicode_Check(arg) || env->isJavaStr(arg))
     {
         if (obj != NULL)
         {
@@ -2280,7 +3694,7 @@ int boxString(PyTypeObject *type, PyObject *arg, java::lang::Object *obj)
     if (result <= 0)
         return result;
 
-    if (PyBytes_Check(arg) || PyUnicode_Check(arg))
+    if (PyBytes_Check(arg) || PyUnicode_Check(arg) || env->isJavaStr(arg))
     {
         if (obj != NULL)
         {
@@ -2304,7 +3718,8 @@ int boxObject(PyTypeObject *type, PyObject *arg, java::lang::Object *obj)
 
     if (obj != NULL)
     {
-        if (PyBytes_Check(arg) || PyUnicode_Check(arg))
+        if (PyBytes_Check(arg) || PyUnicode_Check(arg) ||
+            env->isJavaStr(arg))
         {
             *obj = p2j(arg);
             if (PyErr_Occurred())
@@ -2332,7 +3747,7 @@ int boxObject(PyTypeObject *type, PyObject *arg, java::lang::Object *obj)
             return -1;
     }
     else if (!(PyBytes_Check(arg) || PyUnicode_Check(arg) ||
-               arg == Py_True || arg == Py_False ||
+               env->isJavaStr(arg) || arg == Py_True || arg == Py_False ||
                PyInt_Check(arg) || PyLong_Check(arg) ||
                PyFloat_Check(arg)))
         return -1;
@@ -32,6 +32,7 @@ PyObject *PyErr_SetJavaError();
 
 extern PyObject *PyExc_JavaError;
 extern PyObject *PyExc_InvalidArgsError;
+extern PyObject *PyExc_JavaTimeoutError;
 
 
 void throwPythonError(void);
@@ -90,6 +91,8 @@ int boxObject(PyTypeObject *type, PyObject *arg, java::lang::Object *obj);
 PyObject *j2p(const java::lang::String& js);
 java::lang::String p2j(PyObject *object);
 
+PyObject *make_string_iterator(jobject iterator);
+
 PyObject *make_descriptor(PyTypeObject *value);
 PyObject *make_descriptor(getclassfn initializeClass);
 PyObject *make_descriptor(getclassfn initializeClass, int generics);
@@ -267,6 +270,12 @@ PyObject *get_extension_iterator(PyObject *self);
 PyObject *get_extension_next(PyObject *self);
 PyObject *get_extension_nextElement(PyObject *self);
 
+PyObject *get_future_await(PyObject *self);
+PyObject *offload(PyObject *self, PyObject *args);
+#if PY_VERSION_HEX >= 0x03050000
+extern PyAsyncMethods future_as_async;
+#endif
+
 jobjectArray fromPySequence(jclass cls, PyObject *sequence);
 jobjectArray fromPySequence(jclass cls, PyObject **args, int length);
 PyObject *castCheck(PyObject *obj, getclassfn initializeClass,
@@ -280,6 +289,7 @@ PyObject *typeParameters(PyTypeObject *types[], size_t size);
 
 extern PyTypeObject PY_TYPE(FinalizerClass);
 extern PyTypeObject PY_TYPE(FinalizerProxy);
+extern PyTypeObject PY_TYPE(StringIterator);
 
 typedef struct {
     PyObject_HEAD
@@ -21,6 +21,11 @@
 #include <dlfcn.h>
 #endif
 
+#if !defined(_MSC_VER) && !defined(__WIN32)
+#include <unistd.h>
+#include <time.h>
+#endif
+
 #include <Python.h>
 #include "structmember.h"
 
@@ -33,6 +38,8 @@ _DLL_EXPORT JCCEnv *env;
 
 /* JCCEnv */
 
+extern PyTypeObject PY_TYPE(JavaStr);
+
 class t_jccenv {
 public:
     PyObject_HEAD
@@ -40,6 +47,7 @@ public:
 };
     
 static void t_jccenv_dealloc(t_jccenv *self);
+
 static PyObject *t_jccenv_attachCurrentThread(PyObject *self, PyObject *args);
 static PyObject *t_jccenv_detachCurrentThread(PyObject *self);
 static PyObject *t_jccenv_isCurrentThreadAttached(PyObject *self);
@@ -48,6 +56,20 @@ static PyObject *t_jccenv_strhash(PyObject *self, PyObject *arg);
 static PyObject *t_jccenv__dumpRefs(PyObject *self,
                                     PyObject *args, PyObject *kwds);
 static PyObject *t_jccenv__addClassPath(PyObject *self, PyObject *args);
+static PyObject *t_jccenv_setWorkerPool(PyObject *self,
+                                        PyObject *args, PyObject *kwds);
+static PyObject *t_jccenv_parallel_map(PyObject *self, PyObject *args);
+static PyObject *t_jccenv__threadStates(PyObject *self);
+static PyObject *t_jccenv_startCallQueue(PyObject *self,
+                                         PyObject *args, PyObject *kwds);
+static PyObject *t_jccenv_stopCallQueue(PyObject *self);
+static PyObject *t_jccenv__callQueue(PyObject *self);
+static PyObject *t_jccenv_setCallGate(PyObject *self,
+                                      PyObject *args, PyObject *kwds);
+static PyObject *t_jccenv__callGate(PyObject *self);
+static PyObject *t_jccenv_deadline(PyObject *self, PyObject *arg);
+static PyObject *t_jccenv_setStringCache(PyObject *self, PyObject *arg);
+static PyObject *t_jccenv__stringCache(PyObject *self);
 
 static PyObject *t_jccenv__get_jni_version(PyObject *self, void *data);
 static PyObject *t_jccenv__get_java_version(PyObject *self, void *data);
@@ -79,6 +101,28 @@ static PyMethodDef t_jccenv_methods[] = {
       METH_VARARGS | METH_KEYWORDS, NULL },
     { "_addClassPath", (PyCFunction) t_jccenv__addClassPath,
       METH_VARARGS, NULL },
+    { "setWorkerPool", (PyCFunction) t_jccenv_setWorkerPool,
+      METH_VARARGS | METH_KEYWORDS, NULL },
+    { "parallel_map", (PyCFunction) t_jccenv_parallel_map,
+      METH_VARARGS, NULL },
+    { "_threadStates", (PyCFunction) t_jccenv__threadStates,
+      METH_NOARGS, NULL },
+    { "startCallQueue", (PyCFunction) t_jccenv_startCallQueue,
+      METH_VARARGS | METH_KEYWORDS, NULL },
+    { "stopCallQueue", (PyCFunction) t_jccenv_stopCallQueue,
+      METH_NOARGS, NULL },
+    { "_callQueue", (PyCFunction) t_jccenv__callQueue,
+      METH_NOARGS, NULL },
+    { "setCallGate", (PyCFunction) t_jccenv_setCallGate,
+      METH_VARARGS | METH_KEYWORDS, NULL },
+    { "_callGate", (PyCFunction) t_jccenv__callGate,
+      METH_NOARGS, NULL },
+    { "deadline", (PyCFunction) t_jccenv_deadline,
+      METH_O, NULL },
+    { "setStringCache", (PyCFunction) t_jccenv_setStringCache,
+      METH_O, NULL },
+    { "_stringCache", (PyCFunction) t_jccenv__stringCache,
+      METH_NOARGS, NULL },
     { NULL, NULL, 0, NULL }
 };
 
@@ -168,6 +212,8 @@ static PyObject *t_jccenv_attachCurrentThread(PyObject *self, PyObject *args)
 
 static PyObject *t_jccenv_detachCurrentThread(PyObject *self)
 {
+    env->releaseThreadState();
+
     int result = env->vm->DetachCurrentThread();
 
     env->set_vm_env(NULL);
@@ -280,6 +326,39 @@ static PyObject *t_jccenv__addClassPath(PyObject *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/* counts of Python thread states kept for Java threads */
+static PyObject *t_jccenv__threadStates(PyObject *self)
+{
+    return Py_BuildValue("{s:n,s:n,s:n}",
+                         "created", env->tstates_created,
+                         "reused", env->tstates_reused,
+                         "released", env->tstates_released);
+}
+
+/* sizes the string cache used by --cache-strings methods, 0 disables it */
+static PyObject *t_jccenv_setStringCache(PyObject *self, PyObject *arg)
+{
+    long size = PyInt_AsLong(arg);
+
+    if (size == -1 && PyErr_Occurred())
+        return NULL;
+
+    if (size < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "size must not be negative");
+        return NULL;
+    }
+
+    env->setStringCache((int) size);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *t_jccenv__stringCache(PyObject *self)
+{
+    return env->getStringCacheStats();
+}
+
 static PyObject *t_jccenv__get_jni_version(PyObject *self, void *data)
 {
     return PyInt_FromLong(env->getJNIVersion());
@@ -305,6 +384,1068 @@ static PyObject *t_jccenv__get_classpath(PyObject *self, void *data)
     Py_RETURN_NONE;
 }
 
+/* worker pool: threads are attached to the JVM once and reused */
+
+#if defined(_MSC_VER) || defined(__WIN32)
+
+typedef CRITICAL_SECTION pool_mutex_t;
+typedef CONDITION_VARIABLE pool_cond_t;
+typedef HANDLE pool_thread_t;
+
+static void pool_lock(pool_mutex_t *mutex) { EnterCriticalSection(mutex); }
+static void pool_unlock(pool_mutex_t *mutex) { LeaveCriticalSection(mutex); }
+static void pool_wait(pool_cond_t *cond, pool_mutex_t *mutex)
+{
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+static void pool_broadcast(pool_cond_t *cond) { WakeAllConditionVariable(cond); }
+
+#else
+
+typedef pthread_mutex_t pool_mutex_t;
+typedef pthread_cond_t pool_cond_t;
+typedef pthread_t pool_thread_t;
+
+static void pool_lock(pool_mutex_t *mutex) { pthread_mutex_lock(mutex); }
+static void pool_unlock(pool_mutex_t *mutex) { pthread_mutex_unlock(mutex); }
+static void pool_wait(pool_cond_t *cond, pool_mutex_t *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+static void pool_broadcast(pool_cond_t *cond) { pthread_cond_broadcast(cond); }
+
+#endif
+
+class poolTask {
+public:
+    PyObject *fn, *args, *result;
+    PyObject *type, *value, *tb;
+    int *pending;
+    poolTask *next;
+
+    poolTask()
+    {
+        fn = args = result = NULL;
+        type = value = tb = NULL;
+        pending = NULL;
+        next = NULL;
+    }
+
+    ~poolTask()
+    {
+        Py_XDECREF(args);
+        Py_XDECREF(result);
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(tb);
+    }
+
+    /* called with the GIL held */
+    void run()
+    {
+        result = PyObject_Call(fn, args, NULL);
+        if (result == NULL)
+            PyErr_Fetch(&type, &value, &tb);
+    }
+};
+
+class workerPool {
+private:
+    pool_mutex_t control;    /* held by start() and stop() */
+    pool_mutex_t mutex;
+    pool_cond_t ready, done;
+    pool_thread_t *threads;
+    int *cpus, ncpus;
+    poolTask *head, *tail;
+    int running;
+    bool stopping;
+
+    void stopThreads();
+
+public:
+    int size;
+
+    workerPool()
+    {
+#if defined(_MSC_VER) || defined(__WIN32)
+        InitializeCriticalSection(&control);
+        InitializeCriticalSection(&mutex);
+        InitializeConditionVariable(&ready);
+        InitializeConditionVariable(&done);
+#else
+        pthread_mutex_init(&control, NULL);
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&ready, NULL);
+        pthread_cond_init(&done, NULL);
+#endif
+        threads = NULL;
+        cpus = NULL;
+        ncpus = 0;
+        head = tail = NULL;
+        running = 0;
+        stopping = false;
+        size = 0;
+    }
+
+    static int defaultSize()
+    {
+#if defined(_MSC_VER) || defined(__WIN32)
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+        return (int) info.dwNumberOfProcessors;
+#else
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        return n > 0 ? (int) n : 1;
+#endif
+    }
+
+    /* called without the GIL, returns the number of threads started,
+     * an already running pool is kept unless replace is true
+     */
+    int start(int size, int *cpus, int ncpus, bool replace);
+    void stop();
+
+    /* called without the GIL, returns when all tasks have run or false
+     * when the pool was stopped
+     */
+    bool run(poolTask *tasks, int count)
+    {
+        int pending = count;
+
+        pool_lock(&mutex);
+        if (threads == NULL || stopping)
+        {
+            pool_unlock(&mutex);
+            return false;
+        }
+
+        running += 1;
+        for (int i = 0; i < count; i++) {
+            tasks[i].pending = &pending;
+            if (tail == NULL)
+                head = &tasks[i];
+            else
+                tail->next = &tasks[i];
+            tail = &tasks[i];
+        }
+        pool_broadcast(&ready);
+
+        while (pending > 0)
+            pool_wait(&done, &mutex);
+
+        if (--running == 0)
+            pool_broadcast(&done);
+        pool_unlock(&mutex);
+
+        return true;
+    }
+
+    bool isWorker()
+    {
+        bool found = false;
+
+        pool_lock(&mutex);
+        for (int i = 0; !found && threads != NULL && i < size; i++) {
+#if defined(_MSC_VER) || defined(__WIN32)
+            found = GetThreadId(threads[i]) == GetCurrentThreadId();
+#else
+            found = pthread_equal(threads[i], pthread_self()) != 0;
+#endif
+        }
+        pool_unlock(&mutex);
+
+        return found;
+    }
+
+    /* called by workers without the GIL, NULL means exit */
+    poolTask *take()
+    {
+        poolTask *task;
+
+        pool_lock(&mutex);
+        while (head == NULL && !stopping)
+            pool_wait(&ready, &mutex);
+
+        task = head;
+        if (task != NULL)
+        {
+            head = task->next;
+            if (head == NULL)
+                tail = NULL;
+        }
+        pool_unlock(&mutex);
+
+        return task;
+    }
+
+    void finish(poolTask *task)
+    {
+        pool_lock(&mutex);
+        if (--*task->pending == 0)
+            pool_broadcast(&done);
+        pool_unlock(&mutex);
+    }
+
+    void pin(int n)
+    {
+        if (ncpus == 0)
+            return;
+#if defined(_MSC_VER) || defined(__WIN32)
+        SetThreadAffinityMask(GetCurrentThread(),
+                              (DWORD_PTR) 1 << cpus[n % ncpus]);
+#elif defined(__linux__)
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpus[n % ncpus], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+    }
+};
+
+static workerPool pool;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+static DWORD WINAPI pool_worker(LPVOID arg)
+#else
+static void *pool_worker(void *arg)
+#endif
+{
+    int n = (int) (Py_intptr_t) arg;
+    char name[32];
+
+    pool.pin(n);
+
+    sprintf(name, "jcc-worker-%d", n);
+    env->attachCurrentThread(name, 1);
+
+    /* keep this thread's Python thread state for the life of the worker */
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyThreadState *state = PyEval_SaveThread();
+
+    for (poolTask *task = pool.take(); task != NULL; task = pool.take()) {
+        PyEval_RestoreThread(state);
+        task->run();
+        state = PyEval_SaveThread();
+        pool.finish(task);
+    }
+
+    PyEval_RestoreThread(state);
+    PyGILState_Release(gil);
+
+    env->releaseThreadState();
+    env->vm->DetachCurrentThread();
+    env->set_vm_env(NULL);
+
+    return 0;
+}
+
+int workerPool::start(int size, int *cpus, int ncpus, bool replace)
+{
+    pool_lock(&control);
+
+    if (!replace && threads != NULL)
+    {
+        pool_unlock(&control);
+        delete[] cpus;
+
+        return this->size;
+    }
+
+    stopThreads();
+
+    pool_thread_t *started = new pool_thread_t[size];
+    int count = 0;
+
+    pool_lock(&mutex);
+    this->cpus = cpus;
+    this->ncpus = ncpus;
+    pool_unlock(&mutex);
+
+    for (int i = 0; i < size; i++) {
+#if defined(_MSC_VER) || defined(__WIN32)
+        started[i] = CreateThread(NULL, 0, pool_worker,
+                                  (LPVOID) (Py_intptr_t) i, 0, NULL);
+        if (started[i] == NULL)
+            break;
+#else
+        if (pthread_create(&started[i], NULL, pool_worker,
+                           (void *) (Py_intptr_t) i))
+            break;
+#endif
+        count += 1;
+    }
+
+    pool_lock(&mutex);
+    if (count > 0)
+    {
+        threads = started;
+        this->size = count;
+    }
+    else
+        delete[] started;
+    pool_unlock(&mutex);
+
+    pool_unlock(&control);
+
+    return count;
+}
+
+void workerPool::stop()
+{
+    pool_lock(&control);
+    stopThreads();
+    pool_unlock(&control);
+}
+
+/* called with control held, waits for the run() calls in progress */
+void workerPool::stopThreads()
+{
+    pool_lock(&mutex);
+    while (running > 0)
+        pool_wait(&done, &mutex);
+    stopping = true;
+    pool_broadcast(&ready);
+    pool_unlock(&mutex);
+
+    if (threads != NULL)
+    {
+        for (int i = 0; i < size; i++) {
+#if defined(_MSC_VER) || defined(__WIN32)
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+#else
+            pthread_join(threads[i], NULL);
+#endif
+        }
+    }
+
+    pool_lock(&mutex);
+    delete[] threads;
+    threads = NULL;
+    stopping = false;
+
+    delete[] cpus;
+    cpus = NULL;
+    ncpus = 0;
+    size = 0;
+    pool_unlock(&mutex);
+}
+
+static int startWorkerPool(int size, PyObject *cpus, bool replace)
+{
+    int *ids = NULL, count = 0;
+
+    if (env->vm == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "initVM() must be called first");
+        return -1;
+    }
+
+    /* a worker would wait for itself to finish */
+    if (pool.isWorker())
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "worker pool cannot be changed from a worker thread");
+        return -1;
+    }
+
+    if (cpus != NULL && cpus != Py_None)
+    {
+        PyObject *fast = PySequence_Fast(cpus, "cpus must be a sequence");
+
+        if (fast == NULL)
+            return -1;
+
+        count = (int) PySequence_Fast_GET_SIZE(fast);
+        ids = new int[count];
+
+        for (int i = 0; i < count; i++) {
+            ids[i] = (int) PyInt_AsLong(PySequence_Fast_GET_ITEM(fast, i));
+            if (ids[i] == -1 && PyErr_Occurred())
+            {
+                delete[] ids;
+                Py_DECREF(fast);
+                return -1;
+            }
+        }
+        Py_DECREF(fast);
+    }
+
+    if (size <= 0)
+        size = workerPool::defaultSize();
+
+    {
+        PythonThreadState state;
+
+        size = pool.start(size, ids, count, replace);
+    }
+
+    if (size == 0)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Could not start worker threads");
+        return -1;
+    }
+
+    return 0;
+}
+
+static PyObject *t_jccenv_setWorkerPool(PyObject *self,
+                                        PyObject *args, PyObject *kwds)
+{
+    static char *kwnames[] = {
+        "size", "cpus", NULL
+    };
+    int size = 0;
+    PyObject *cpus = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iO", kwnames,
+                                     &size, &cpus))
+        return NULL;
+
+    if (startWorkerPool(size, cpus, true) < 0)
+        return NULL;
+
+    return PyInt_FromLong(pool.size);
+}
+
+static PyObject *t_jccenv_parallel_map(PyObject *self, PyObject *args)
+{
+    PyObject *fn, *seq, *fast, *result;
+
+    if (!PyArg_ParseTuple(args, "OO", &fn, &seq))
+        return NULL;
+
+    if (!PyCallable_Check(fn))
+    {
+        PyErr_SetObject(PyExc_TypeError, fn);
+        return NULL;
+    }
+
+    if (pool.isWorker())
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "parallel_map() cannot be called from a worker thread");
+        return NULL;
+    }
+
+    if (pool.size == 0 && startWorkerPool(0, NULL, false) < 0)
+        return NULL;
+
+    fast = PySequence_Fast(seq, "parallel_map() arg 2 must be a sequence");
+    if (fast == NULL)
+        return NULL;
+
+    int count = (int) PySequence_Fast_GET_SIZE(fast);
+    poolTask *tasks = new poolTask[count];
+
+    for (int i = 0; i < count; i++) {
+        PyObject *arg = PySequence_Fast_GET_ITEM(fast, i);
+
+        tasks[i].fn = fn;
+        if (PyTuple_Check(arg))
+        {
+            Py_INCREF(arg);
+            tasks[i].args = arg;
+        }
+        else
+            tasks[i].args = PyTuple_Pack(1, arg);
+
+        if (tasks[i].args == NULL)
+        {
+            delete[] tasks;
+            Py_DECREF(fast);
+            return NULL;
+        }
+    }
+    Py_DECREF(fast);
+
+    bool ran;
+
+    {
+        PythonThreadState state;
+
+        ran = pool.run(tasks, count);
+    }
+
+    if (!ran)
+    {
+        delete[] tasks;
+        PyErr_SetString(PyExc_RuntimeError, "worker pool was stopped");
+        return NULL;
+    }
+
+    result = PyList_New(count);
+    for (int i = 0; result != NULL && i < count; i++) {
+        if (tasks[i].result == NULL)
+        {
+            PyErr_Restore(tasks[i].type, tasks[i].value, tasks[i].tb);
+            tasks[i].type = tasks[i].value = tasks[i].tb = NULL;
+            Py_DECREF(result);
+            result = NULL;
+        }
+        else
+        {
+            PyList_SET_ITEM(result, i, tasks[i].result);
+            tasks[i].result = NULL;
+        }
+    }
+    delete[] tasks;
+
+    return result;
+}
+
+/* call queue: drains calls to --async extension methods queued by Java
+ * threads, one batch per GIL acquisition
+ */
+
+static pool_thread_t drainer;
+static int drainBatch = 0;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+static DWORD WINAPI call_drainer(LPVOID arg)
+#else
+static void *call_drainer(void *arg)
+#endif
+{
+    callQueue *calls = (callQueue *) arg;
+
+    env->attachCurrentThread((char *) "jcc-call-drainer", 1);
+
+    JNIEnv *vm_env = env->get_vm_env();
+    PyGILState_STATE gil = PyGILState_Ensure();
+    PyThreadState *state = PyEval_SaveThread();
+
+    while (calls->wait()) {
+        PyEval_RestoreThread(state);
+        calls->drain(vm_env, drainBatch);
+        state = PyEval_SaveThread();
+    }
+
+    PyEval_RestoreThread(state);
+    PyGILState_Release(gil);
+
+    env->releaseThreadState();
+    env->vm->DetachCurrentThread();
+    env->set_vm_env(NULL);
+
+    return 0;
+}
+
+static PyObject *t_jccenv_startCallQueue(PyObject *self,
+                                         PyObject *args, PyObject *kwds)
+{
+    static char *kwnames[] = {
+        "size", "batch", NULL
+    };
+    int size = 0, batch = 256;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwnames,
+                                     &size, &batch))
+        return NULL;
+
+    if (env->vm == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "initVM() must be called first");
+        return NULL;
+    }
+
+    if (size < 0 || batch <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "size and batch must be positive");
+        return NULL;
+    }
+
+    /* the ring is made by the first start and reused after a stop */
+    if (env->calls != NULL && size > 0 && size != env->calls->size)
+    {
+        PyErr_Format(PyExc_ValueError,
+                     "call queue already made with size %d",
+                     env->calls->size);
+        return NULL;
+    }
+
+    if (drainBatch > 0)
+        Py_RETURN_FALSE;
+
+    /* never freed, Java threads may still be looking at it */
+    if (env->calls == NULL)
+        env->calls = new callQueue(size > 0 ? size : 4096);
+    else
+        env->calls->open();
+
+    drainBatch = batch;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    drainer = CreateThread(NULL, 0, call_drainer, (LPVOID) env->calls, 0, NULL);
+    if (drainer == NULL)
+#else
+    if (pthread_create(&drainer, NULL, call_drainer, (void *) env->calls))
+#endif
+    {
+        env->calls->close();
+        drainBatch = 0;
+
+        PyErr_SetString(PyExc_RuntimeError, "Could not start drainer thread");
+        return NULL;
+    }
+
+    Py_RETURN_TRUE;
+}
+
+/* returns once all queued calls have been made */
+static PyObject *t_jccenv_stopCallQueue(PyObject *self)
+{
+    if (drainBatch == 0)
+        Py_RETURN_FALSE;
+
+    env->calls->close();
+
+    {
+        PythonThreadState state;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+        WaitForSingleObject(drainer, INFINITE);
+        CloseHandle(drainer);
+#else
+        pthread_join(drainer, NULL);
+#endif
+    }
+
+    drainBatch = 0;
+
+    Py_RETURN_TRUE;
+}
+
+static PyObject *t_jccenv__callQueue(PyObject *self)
+{
+    callQueue *calls = env->calls;
+
+    if (calls == NULL)
+        Py_RETURN_NONE;
+
+    return Py_BuildValue("{s:l,s:l,s:l,s:l}",
+                         "queued", calls->queued,
+                         "drained", calls->drained,
+                         "overflows", calls->overflows,
+                         "depth", calls->depth());
+}
+
+/* limit == 0 removes the gate, threads already admitted still leave it */
+static PyObject *t_jccenv_setCallGate(PyObject *self,
+                                      PyObject *args, PyObject *kwds)
+{
+    static char *kwnames[] = {
+        "limit", "fair", NULL
+    };
+    int limit = 0, fair = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwnames,
+                                     &limit, &fair))
+        return NULL;
+
+    if (limit < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "limit must not be negative");
+        return NULL;
+    }
+
+    if (limit == 0)
+    {
+        if (env->gate != NULL)
+            env->gate->configure(INT_MAX, 0);
+        env->gate = NULL;
+    }
+    else
+    {
+        /* never freed, threads in Java may still be using it */
+        static callGate *gate = NULL;
+
+        if (gate == NULL)
+            gate = new callGate(limit, fair);
+        else
+            gate->configure(limit, fair);
+
+        env->gate = gate;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *t_jccenv__callGate(PyObject *self)
+{
+    callGate *gate = env->gate;
+
+    if (gate == NULL)
+        Py_RETURN_NONE;
+
+    return Py_BuildValue("{s:i,s:O,s:l,s:l,s:l,s:l,s:l}",
+                         "limit", gate->limit,
+                         "fair", gate->fair ? Py_True : Py_False,
+                         "active", gate->active,
+                         "waiting", gate->waiting,
+                         "peak", gate->peak,
+                         "admitted", gate->admitted,
+                         "delayed", gate->delayed);
+}
+
+/* deadlines: a timer thread interrupts the Java threads whose deadline
+ * passed, see isDeadlineInterruption() for how that is then reported
+ */
+
+class deadlineTimer {
+private:
+    pool_mutex_t mutex;
+    pool_cond_t changed;
+    std::multimap<double, callDeadline *> pending;
+    jclass threadClass;
+    jmethodID mid_currentThread, mid_interrupt, mid_interrupted;
+    bool started;
+
+    /* waits on the monotonic clock of now(), never for less than 1ms on
+     * Windows lest a deadline less than 1ms away turns into a busy loop
+     */
+    void wait(double secs)
+    {
+#if defined(_MSC_VER) || defined(__WIN32)
+        DWORD ms = (DWORD) (secs * 1000.0);
+
+        SleepConditionVariableCS(&changed, &mutex, ms > 0 ? ms : 1);
+#elif defined(__APPLE__)
+        struct timespec ts;
+
+        ts.tv_sec = (time_t) secs;
+        ts.tv_nsec = (long) ((secs - (double) ts.tv_sec) * 1e9);
+        pthread_cond_timedwait_relative_np(&changed, &mutex, &ts);
+#else
+        double when = now() + secs;
+        struct timespec ts;
+
+        ts.tv_sec = (time_t) when;
+        ts.tv_nsec = (long) ((when - (double) ts.tv_sec) * 1e9);
+        pthread_cond_timedwait(&changed, &mutex, &ts);
+#endif
+    }
+
+public:
+    deadlineTimer()
+    {
+#if defined(_MSC_VER) || defined(__WIN32)
+        InitializeCriticalSection(&mutex);
+        InitializeConditionVariable(&changed);
+#else
+        pthread_condattr_t attr;
+
+        pthread_condattr_init(&attr);
+#if !defined(__APPLE__)
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&changed, &attr);
+        pthread_condattr_destroy(&attr);
+#endif
+        threadClass = NULL;
+        started = false;
+    }
+
+    static double now()
+    {
+#if defined(_MSC_VER) || defined(__WIN32)
+        return (double) GetTickCount64() / 1000.0;
+#else
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+    }
+
+    /* called with the GIL held */
+    int start();
+    jobject currentThread(JNIEnv *vm_env)
+    {
+        return vm_env->CallStaticObjectMethod(threadClass, mid_currentThread);
+    }
+    void clearInterrupt(JNIEnv *vm_env)
+    {
+        vm_env->CallStaticBooleanMethod(threadClass, mid_interrupted);
+    }
+
+    void add(callDeadline *deadline)
+    {
+        pool_lock(&mutex);
+        pending.insert(std::pair<const double, callDeadline *>(deadline->when, deadline));
+        pool_broadcast(&changed);
+        pool_unlock(&mutex);
+    }
+
+    /* once this returns, the deadline's thread is not interrupted anymore */
+    void remove(callDeadline *deadline)
+    {
+        pool_lock(&mutex);
+        std::multimap<double, callDeadline *>::iterator iter =
+            pending.lower_bound(deadline->when);
+
+        while (iter != pending.end() && iter->first == deadline->when) {
+            if (iter->second == deadline)
+            {
+                pending.erase(iter);
+                break;
+            }
+            ++iter;
+        }
+        pool_unlock(&mutex);
+    }
+
+    /* called by the timer thread, never returns */
+    void run(JNIEnv *vm_env)
+    {
+        pool_lock(&mutex);
+        for (;;) {
+            if (pending.empty())
+            {
+                pool_wait(&changed, &mutex);
+                continue;
+            }
+
+            std::multimap<double, callDeadline *>::iterator iter =
+                pending.begin();
+            double left = iter->first - now();
+
+            if (left > 0.0)
+                wait(left);
+            else
+            {
+                callDeadline *deadline = iter->second;
+
+                pending.erase(iter);
+                deadline->fired = 1;
+
+                vm_env->CallVoidMethod(deadline->thread, mid_interrupt);
+                if (vm_env->ExceptionCheck())
+                    vm_env->ExceptionClear();
+            }
+        }
+    }
+};
+
+static deadlineTimer timer;
+
+#if defined(_MSC_VER) || defined(__WIN32)
+static DWORD WINAPI deadline_timer(LPVOID arg)
+#else
+static void *deadline_timer(void *arg)
+#endif
+{
+    env->attachCurrentThread((char *) "jcc-deadline-timer", 1);
+    timer.run(env->get_vm_env());
+
+    return 0;
+}
+
+int deadlineTimer::start()
+{
+    if (started)
+        return 0;
+
+    JNIEnv *vm_env = env->get_vm_env();
+    jclass cls = vm_env->FindClass("java/lang/Thread");
+
+    threadClass = (jclass) vm_env->NewGlobalRef(cls);
+    vm_env->DeleteLocalRef(cls);
+
+    mid_currentThread = vm_env->GetStaticMethodID(threadClass, "currentThread",
+                                                  "()Ljava/lang/Thread;");
+    mid_interrupted = vm_env->GetStaticMethodID(threadClass, "interrupted",
+                                                "()Z");
+    mid_interrupt = vm_env->GetMethodID(threadClass, "interrupt", "()V");
+
+#if defined(_MSC_VER) || defined(__WIN32)
+    HANDLE thread = CreateThread(NULL, 0, deadline_timer, NULL, 0, NULL);
+
+    if (thread == NULL)
+        return -1;
+    CloseHandle(thread);
+#else
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, deadline_timer, NULL))
+        return -1;
+    pthread_detach(thread);
+#endif
+
+    started = true;
+
+    return 0;
+}
+
+class t_deadline {
+public:
+    PyObject_HEAD
+    double secs;
+    callDeadline deadline;
+    int entered;
+};
+
+static void t_deadline_dealloc(t_deadline *self);
+static PyObject *t_deadline_enter(t_deadline *self);
+static PyObject *t_deadline_exit(t_deadline *self, PyObject *args);
+
+static PyMethodDef t_deadline_methods[] = {
+    { "__enter__", (PyCFunction) t_deadline_enter, METH_NOARGS, NULL },
+    { "__exit__", (PyCFunction) t_deadline_exit, METH_VARARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+PyTypeObject PY_TYPE(JCCDeadline) = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "jcc.JCCDeadline",                   /* tp_name */
+    sizeof(t_deadline),                  /* tp_basicsize */
+    0,                                   /* tp_itemsize */
+    (destructor)t_deadline_dealloc,      /* tp_dealloc */
+    0,                                   /* tp_print */
+    0,                                   /* tp_getattr */
+    0,                                   /* tp_setattr */
+    0,                                   /* tp_compare */
+    0,                                   /* tp_repr */
+    0,                                   /* tp_as_number */
+    0,                                   /* tp_as_sequence */
+    0,                                   /* tp_as_mapping */
+    0,                                   /* tp_hash  */
+    0,                                   /* tp_call */
+    0,                                   /* tp_str */
+    0,                                   /* tp_getattro */
+    0,                                   /* tp_setattro */
+    0,                                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                  /* tp_flags */
+    "JCCDeadline",                       /* tp_doc */
+    0,                                   /* tp_traverse */
+    0,                                   /* tp_clear */
+    0,                                   /* tp_richcompare */
+    0,                                   /* tp_weaklistoffset */
+    0,                                   /* tp_iter */
+    0,                                   /* tp_iternext */
+    t_deadline_methods,                  /* tp_methods */
+    0,                                   /* tp_members */
+    0,                                   /* tp_getset */
+    0,                                   /* tp_base */
+    0,                                   /* tp_dict */
+    0,                                   /* tp_descr_get */
+    0,                                   /* tp_descr_set */
+    0,                                   /* tp_dictoffset */
+    0,                                   /* tp_init */
+    0,                                   /* tp_alloc */
+    0,                                   /* tp_new */
+};
+
+static PyObject *t_jccenv_deadline(PyObject *self, PyObject *arg)
+{
+    double secs = PyFloat_AsDouble(arg);
+
+    if (secs == -1.0 && PyErr_Occurred())
+        return NULL;
+
+    if (env->vm == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "initVM() must be called first");
+        return NULL;
+    }
+
+    t_deadline *deadline = (t_deadline *)
+        PY_TYPE(JCCDeadline).tp_alloc(&PY_TYPE(JCCDeadline), 0);
+
+    if (deadline != NULL)
+    {
+        deadline->secs = secs;
+        deadline->deadline.thread = NULL;
+        deadline->entered = 0;
+    }
+
+    return (PyObject *) deadline;
+}
+
+static PyObject *t_deadline_enter(t_deadline *self)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+
+    if (self->entered)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "deadline already entered");
+        return NULL;
+    }
+
+    if (vm_env == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "attachCurrentThread() must be called first");
+        return NULL;
+    }
+
+    if (timer.start() < 0)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Could not start timer thread");
+        return NULL;
+    }
+
+    jobject thread = timer.currentThread(vm_env);
+
+    self->deadline.thread = vm_env->NewGlobalRef(thread);
+    vm_env->DeleteLocalRef(thread);
+
+    self->deadline.when = deadlineTimer::now() + self->secs;
+    self->deadline.fired = 0;
+    self->deadline.outer = env->getDeadline();
+    self->entered = 1;
+
+    env->setDeadline(&self->deadline);
+    timer.add(&self->deadline);
+
+    Py_RETURN_SELF;
+}
+
+static void leave_deadline(t_deadline *self)
+{
+    JNIEnv *vm_env = env->get_vm_env();
+    callDeadline *outer = self->deadline.outer;
+
+    timer.remove(&self->deadline);
+    env->setDeadline(outer);
+    self->entered = 0;
+
+    if (vm_env == NULL)
+        return;
+
+    /* don't leave this deadline's interrupt behind for later calls */
+    if (self->deadline.fired)
+    {
+        while (outer != NULL && !outer->fired)
+            outer = outer->outer;
+        if (outer == NULL)
+            timer.clearInterrupt(vm_env);
+    }
+
+    vm_env->DeleteGlobalRef(self->deadline.thread);
+    self->deadline.thread = NULL;
+}
+
+static PyObject *t_deadline_exit(t_deadline *self, PyObject *args)
+{
+    if (self->entered)
+        leave_deadline(self);
+
+    Py_RETURN_FALSE;
+}
+
+static void t_deadline_dealloc(t_deadline *self)
+{
+    if (self->entered)
+        leave_deadline(self);
+
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
 _DLL_EXPORT PyObject *getVMEnv(PyObject *self)
 {
     if (env->vm != NULL)
@@ -337,6 +1478,8 @@ _DLL_EXPORT PyObject *initJCC(PyObject *module)
     {
         PyEval_InitThreads();
         INSTALL_TYPE(JCCEnv, module);
+        INSTALL_TYPE(JCCDeadline, module);
+        INSTALL_TYPE(JavaStr, module);
 
         if (env == NULL)
             env = new JCCEnv(NULL, NULL);
@@ -706,7 +1849,7 @@ static void _PythonVM_init(JNIEnv *vm_env, jobject self,
         PySys_SetArgv(1, (wchar_t **) &wchars);
 #endif
 
-    PyEval_ReleaseLock();
+    PyEval_SaveThread();
 }
 
 static jobject _PythonVM_instantiate(JNIEnv *vm_env, jobject self,
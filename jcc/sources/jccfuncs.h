@@ -26,6 +26,11 @@ PyObject *findClass(PyObject *self, PyObject *args);
 PyObject *makeInterface(PyObject *self, PyObject *args);
 PyObject *makeClass(PyObject *self, PyObject *args);
 PyObject *JArray_Type(PyObject *self, PyObject *arg);
+PyObject *offload(PyObject *self, PyObject *args);
+PyObject *setStringArgCache(PyObject *self, PyObject *arg);
+PyObject *_stringArgCache(PyObject *self);
+PyObject *charSequence(PyObject *self, PyObject *arg);
+PyObject *iterStrings(PyObject *self, PyObject *arg);
 
 PyMethodDef jcc_funcs[] = {
     { "initVM", (PyCFunction) __initialize__,
@@ -44,6 +49,16 @@ PyMethodDef jcc_funcs[] = {
       METH_VARARGS, NULL },
     { "JArray", (PyCFunction) JArray_Type,
       METH_O, NULL },
+    { "offload", (PyCFunction) offload,
+      METH_VARARGS, NULL },
+    { "setStringArgCache", (PyCFunction) setStringArgCache,
+      METH_O, NULL },
+    { "_stringArgCache", (PyCFunction) _stringArgCache,
+      METH_NOARGS, NULL },
+    { "charSequence", (PyCFunction) charSequence,
+      METH_O, NULL },
+    { "iterStrings", (PyCFunction) iterStrings,
+      METH_O, NULL },
     { NULL, NULL, 0, NULL }
 };
 
@@ -180,5 +180,42 @@ PyObject *t_name::wrap_jobject(const jobject& object)                   \
 
 #endif /* PY_MAJOR_VERSION < 3 */
 
+#if PY_VERSION_HEX < 0x03030000
+#define PyUnicode_GET_LENGTH        PyUnicode_GET_SIZE
+#define PyUnicode_READ_CHAR(o, i)   ((Py_UCS4) PyUnicode_AS_UNICODE(o)[i])
+#endif
+
+#if PY_VERSION_HEX < 0x030900A4 && !defined(Py_SET_TYPE)
+#define Py_SET_TYPE(ob, type)       (Py_TYPE(ob) = (type))
+#endif
+
+/* per-object locks of free-threaded builds, no-ops before 3.13 */
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op)   {
+#define Py_END_CRITICAL_SECTION()       }
+#endif
+
+/* guards PySequence_Fast_ITEMS() of a list against concurrent resizing,
+ * only declared in the internal headers of 3.13
+ */
+#ifndef Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST
+#ifdef Py_GIL_DISABLED
+#define Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(original)               \
+    {                                                                   \
+        PyObject *_orig_seq = (PyObject *) (original);                  \
+        const int _should_lock_cs = PyList_CheckExact(_orig_seq);       \
+        PyCriticalSection _cs;                                          \
+        if (_should_lock_cs)                                            \
+            PyCriticalSection_Begin(&_cs, _orig_seq);
+#define Py_END_CRITICAL_SECTION_SEQUENCE_FAST()                         \
+        if (_should_lock_cs)                                            \
+            PyCriticalSection_End(&_cs);                                \
+    }
+#else
+#define Py_BEGIN_CRITICAL_SECTION_SEQUENCE_FAST(original)   {
+#define Py_END_CRITICAL_SECTION_SEQUENCE_FAST()             }
+#endif
+#endif
+
 
 #endif /* _macros_H */
@@ -473,9 +473,7 @@ PyObject *make_descriptor(jchar value)
 
     if (self)
     {
-        Py_UNICODE pchar = (Py_UNICODE) value;
-
-        self->access.value = PyUnicode_FromUnicode(&pchar, 1);
+        self->access.value = PyUnicode_FromOrdinal((int) value);
         self->flags = DESCRIPTOR_VALUE;
     }
 
@@ -574,3 +572,136 @@ static PyObject *t_descriptor___get__(t_descriptor *self,
     Py_RETURN_NONE;
 }
 
+
+
+/* string iterator: iterates a Java Iterator<String> by fetching packed
+ * chunks of strings, see JCCEnv::nextJStrings(), which grow from
+ * STRING_CHUNK_MIN to STRING_CHUNK_MAX so that an early break is cheap.
+ */
+
+#define STRING_CHUNK_MIN 16
+#define STRING_CHUNK_MAX 1024
+
+class t_string_iterator {
+public:
+    PyObject_HEAD
+    JObject iterator;
+    PyObject *chunk;
+    Py_ssize_t position;
+    int size;
+};
+
+static void t_string_iterator_dealloc(t_string_iterator *self);
+static PyObject *t_string_iterator_iternext(t_string_iterator *self);
+
+PyTypeObject PY_TYPE(StringIterator) = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "jcc.StringIterator",                /* tp_name */
+    sizeof(t_string_iterator),           /* tp_basicsize */
+    0,                                   /* tp_itemsize */
+    (destructor)t_string_iterator_dealloc, /* tp_dealloc */
+    0,                                   /* tp_print */
+    0,                                   /* tp_getattr */
+    0,                                   /* tp_setattr */
+    0,                                   /* tp_compare */
+    0,                                   /* tp_repr */
+    0,                                   /* tp_as_number */
+    0,                                   /* tp_as_sequence */
+    0,                                   /* tp_as_mapping */
+    0,                                   /* tp_hash  */
+    0,                                   /* tp_call */
+    0,                                   /* tp_str */
+    0,                                   /* tp_getattro */
+    0,                                   /* tp_setattro */
+    0,                                   /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                  /* tp_flags */
+    "Iterator<String> in packed chunks", /* tp_doc */
+    0,                                   /* tp_traverse */
+    0,                                   /* tp_clear */
+    0,                                   /* tp_richcompare */
+    0,                                   /* tp_weaklistoffset */
+    PyObject_SelfIter,                   /* tp_iter */
+    (iternextfunc)t_string_iterator_iternext, /* tp_iternext */
+    0,                                   /* tp_methods */
+    0,                                   /* tp_members */
+    0,                                   /* tp_getset */
+    0,                                   /* tp_base */
+    0,                                   /* tp_dict */
+    0,                                   /* tp_descr_get */
+    0,                                   /* tp_descr_set */
+    0,                                   /* tp_dictoffset */
+    0,                                   /* tp_init */
+    0,                                   /* tp_alloc */
+    0,                                   /* tp_new */
+};
+
+PyObject *make_string_iterator(jobject iterator)
+{
+    t_string_iterator *self = (t_string_iterator *)
+        PY_TYPE(StringIterator).tp_alloc(&PY_TYPE(StringIterator), 0);
+
+    if (self)
+    {
+        self->iterator = JObject(iterator);
+        self->chunk = NULL;
+        self->position = 0;
+        self->size = STRING_CHUNK_MIN;
+    }
+
+    return (PyObject *) self;
+}
+
+static void t_string_iterator_dealloc(t_string_iterator *self)
+{
+    self->iterator = JObject(NULL);
+    Py_XDECREF(self->chunk);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *t_string_iterator_iternext(t_string_iterator *self)
+{
+    if (self->chunk == NULL || self->position == PyList_GET_SIZE(self->chunk))
+    {
+        PyObject *chunk = NULL;
+
+        /* an empty chunk is kept to mark the end */
+        if (self->chunk != NULL && PyList_GET_SIZE(self->chunk) == 0)
+        {
+            PyErr_SetNone(PyExc_StopIteration);
+            return NULL;
+        }
+
+        try {
+            chunk = env->nextJStrings(self->iterator.this$, self->size);
+        } catch (int e) {
+            switch (e) {
+              case _EXC_PYTHON:
+                return NULL;
+              case _EXC_JAVA:
+                return PyErr_SetJavaError();
+              default:
+                throw;
+            }
+        }
+        if (chunk == NULL)
+            return NULL;
+
+        Py_XDECREF(self->chunk);
+        self->chunk = chunk;
+        self->position = 0;
+
+        if (self->size < STRING_CHUNK_MAX)
+            self->size *= 2;
+
+        if (PyList_GET_SIZE(chunk) == 0)
+        {
+            PyErr_SetNone(PyExc_StopIteration);
+            return NULL;
+        }
+    }
+
+    PyObject *string = PyList_GET_ITEM(self->chunk, self->position++);
+
+    Py_INCREF(string);
+    return string;
+}